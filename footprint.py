@@ -0,0 +1,268 @@
+"""
+Post build RAM and flash footprint report
+
+Parses the section headers and symbols of the ELF file and the input
+sections of the linker map file. Prints the totals, the largest modules
+(object files and libraries) and the largest symbols and checks them
+against the budgets set in platformio.ini:
+
+    custom_footprint_flash = <bytes>       budget for flash (code, constants, data initializers)
+    custom_footprint_ram = <bytes>         budget for static RAM (data and bss, without heap and stack)
+    custom_footprint_modules =             optional per module budgets, one per line
+        app.cpp.o:ram:2048
+        zone_index.cpp.o:flash:4096
+    custom_footprint_top = <n>             number of modules and symbols listed, default 15
+    custom_footprint_strict = 1            fail the build if a budget is exceeded
+
+Can be used without PlatformIO as well:
+
+    python footprint.py firmware.elf firmware.map --flash 815104 --ram 237568
+"""
+import os
+import re
+import subprocess
+import sys
+
+try:
+    Import("env")
+except NameError:
+    env = None
+
+# Output sections reserved for heap and stack, not counted as static RAM
+RESERVED_SECTIONS = (".heap", ".stack_dummy", ".stack")
+
+
+def tool_path(cc, tool):
+    """Name of a binutils tool of the toolchain, derived from the compiler name"""
+    if cc.endswith("gcc"):
+        return cc[:-3] + tool
+    return tool
+
+
+def run_tool(cmd):
+    try:
+        return subprocess.check_output(cmd, universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as error:
+        print("footprint: %s failed: %s" % (cmd[0], error))
+        return ""
+
+
+def read_sections(objdump, elf):
+    """Allocated output sections as (name, address, size, kind), kind is flash, data or bss"""
+    sections = []
+    lines = run_tool([objdump, "-h", elf]).splitlines()
+    for idx, line in enumerate(lines):
+        fields = line.split()
+        if len(fields) < 7 or not fields[0].isdigit() or idx + 1 >= len(lines):
+            continue
+        flags = lines[idx + 1]
+        if "ALLOC" not in flags:
+            continue
+        name = fields[1]
+        size = int(fields[2], 16)
+        address = int(fields[3], 16)
+        if "LOAD" not in flags:
+            kind = "bss"
+        elif "READONLY" in flags or "CODE" in flags:
+            kind = "flash"
+        else:
+            kind = "data"
+        sections.append((name, address, size, kind))
+    return sections
+
+
+def section_kind(name):
+    """Kind of an input section of the map file"""
+    if name.startswith((".text", ".rodata", ".ARM.ex", ".glue", ".init", ".fini", ".isr_vector", ".vfp11")):
+        return "flash"
+    if name.startswith(".data"):
+        return "data"
+    if name.startswith((".bss", "COMMON", ".noinit")):
+        return "bss"
+    return None
+
+
+def module_name(path):
+    """Object file name, or archive name for objects taken from a library"""
+    match = re.match(r"(.*\.a)\((.*)\)$", path)
+    if match:
+        return os.path.basename(match.group(1))
+    return os.path.basename(path)
+
+
+def read_modules(map_file):
+    """Size per module and kind from the input sections of the map file"""
+    modules = {}
+    input_section = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+    continued = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+    pending = None
+    in_memory_map = False
+    with open(map_file) as f:
+        for line in f:
+            line = line.rstrip()
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+            match = input_section.match(line)
+            if match:
+                if match.group(2) is None:
+                    # Long section name, address and size follow on the next line
+                    pending = match.group(1)
+                    continue
+                name, size, path = match.group(1), int(match.group(3), 16), match.group(4)
+            elif pending is not None:
+                match = continued.match(line)
+                name, pending = pending, None
+                if not match:
+                    continue
+                size, path = int(match.group(2), 16), match.group(3)
+            else:
+                continue
+            kind = section_kind(name)
+            if kind is None or size == 0:
+                continue
+            entry = modules.setdefault(module_name(path.strip()), {"flash": 0, "data": 0, "bss": 0})
+            entry[kind] += size
+    return modules
+
+
+def read_symbols(nm, elf, sections):
+    """Symbols with size as (name, size, kind), kind from the output section of the address"""
+    symbols = []
+    for line in run_tool([nm, "-S", "-C", "--size-sort", elf]).splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        address = int(fields[0], 16)
+        size = int(fields[1], 16)
+        for (name, start, length, kind) in sections:
+            if start <= address < start + length:
+                if not name.startswith(RESERVED_SECTIONS):
+                    symbols.append((fields[3], size, kind))
+                break
+    return symbols
+
+
+def flash_of(entry):
+    return entry["flash"] + entry["data"]
+
+
+def ram_of(entry):
+    return entry["data"] + entry["bss"]
+
+
+def percent(used, budget):
+    return " %5.1f%% of %d" % (100.0 * used / budget, budget) if budget else ""
+
+
+def parse_module_budgets(text):
+    """module:flash|ram:bytes lines into {(module, kind): bytes}"""
+    budgets = {}
+    for item in text.replace(",", "\n").splitlines():
+        item = item.strip()
+        if not item:
+            continue
+        fields = item.rsplit(":", 2)
+        if len(fields) != 3 or fields[1] not in ("flash", "ram") or not fields[2].isdigit():
+            print("footprint: invalid module budget '%s'" % item)
+            continue
+        budgets[(fields[0], fields[1])] = int(fields[2])
+    return budgets
+
+
+def report(elf, map_file, objdump, nm, flash_budget, ram_budget, module_budgets, top):
+    """Print the report, returns the number of exceeded budgets"""
+    sections = read_sections(objdump, elf)
+    totals = {"flash": 0, "data": 0, "bss": 0, "reserved": 0}
+    for (name, address, size, kind) in sections:
+        totals["reserved" if name.startswith(RESERVED_SECTIONS) else kind] += size
+    modules = read_modules(map_file) if map_file and os.path.isfile(map_file) else {}
+    symbols = read_symbols(nm, elf, sections)
+
+    over = []
+    flash_total = flash_of(totals)
+    ram_total = ram_of(totals)
+    print("#########################################################")
+    print("Footprint of " + os.path.basename(elf))
+    print("#########################################################")
+    print("Flash  %7d bytes%s" % (flash_total, percent(flash_total, flash_budget)))
+    print("RAM    %7d bytes%s (data %d, bss %d)" % (ram_total, percent(ram_total, ram_budget), totals["data"], totals["bss"]))
+    print("Heap and stack reserved %d bytes" % totals["reserved"])
+    if flash_budget and flash_total > flash_budget:
+        over.append("flash %d > %d" % (flash_total, flash_budget))
+    if ram_budget and ram_total > ram_budget:
+        over.append("RAM %d > %d" % (ram_total, ram_budget))
+
+    if modules:
+        print("")
+        print("Largest modules by RAM          flash      RAM")
+        for name in sorted(modules, key=lambda name: ram_of(modules[name]), reverse=True)[:top]:
+            print("  %-28s %8d %8d" % (name[:28], flash_of(modules[name]), ram_of(modules[name])))
+        print("Largest modules by flash        flash      RAM")
+        for name in sorted(modules, key=lambda name: flash_of(modules[name]), reverse=True)[:top]:
+            print("  %-28s %8d %8d" % (name[:28], flash_of(modules[name]), ram_of(modules[name])))
+
+    for kind in ("ram", "flash"):
+        listed = [symbol for symbol in symbols if (symbol[2] != "flash") == (kind == "ram")]
+        if not listed:
+            continue
+        print("Largest %s symbols" % ("RAM" if kind == "ram" else "flash"))
+        for (name, size, section) in sorted(listed, key=lambda symbol: symbol[1], reverse=True)[:top]:
+            print("  %8d %-5s %s" % (size, section, name[:80]))
+
+    for ((name, kind), budget) in sorted(module_budgets.items()):
+        entry = modules.get(name)
+        if entry is None:
+            print("footprint: module %s not found in the map file" % name)
+            continue
+        used = ram_of(entry) if kind == "ram" else flash_of(entry)
+        print("Budget %-28s %-5s %7d bytes%s" % (name[:28], kind, used, percent(used, budget)))
+        if used > budget:
+            over.append("%s %s %d > %d" % (name, kind, used, budget))
+
+    for item in over:
+        print("footprint: budget exceeded, " + item)
+    print("#########################################################")
+    return len(over)
+
+
+def project_option(name, default):
+    try:
+        value = env.GetProjectOption(name)
+    except Exception:
+        return default
+    return value if value is not None else default
+
+
+def post_build(source, target, env):
+    elf = target[0].get_abspath()
+    map_file = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+    cc = env.subst("$CC")
+    flash_budget = int(project_option("custom_footprint_flash", "0"), 0)
+    ram_budget = int(project_option("custom_footprint_ram", "0"), 0)
+    module_budgets = parse_module_budgets(project_option("custom_footprint_modules", ""))
+    top = int(project_option("custom_footprint_top", "15"), 0)
+    strict = project_option("custom_footprint_strict", "0").strip() in ("1", "yes", "true")
+    over = report(elf, map_file, tool_path(cc, "objdump"), tool_path(cc, "nm"),
+                  flash_budget, ram_budget, module_budgets, top)
+    if over and strict:
+        env.Exit(1)
+
+
+if env is not None:
+    # Map file is needed for the per module sizes
+    env.Append(LINKFLAGS=["-Wl,-Map,$BUILD_DIR/firmware.map"])
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", post_build)
+elif __name__ == "__main__":
+    import argparse
+    parser = argparse.ArgumentParser(description="RAM and flash footprint report")
+    parser.add_argument("elf")
+    parser.add_argument("map", nargs="?")
+    parser.add_argument("--flash", type=lambda value: int(value, 0), default=0, help="flash budget in bytes")
+    parser.add_argument("--ram", type=lambda value: int(value, 0), default=0, help="static RAM budget in bytes")
+    parser.add_argument("--module", action="append", default=[], help="module budget module:flash|ram:bytes")
+    parser.add_argument("--top", type=int, default=15)
+    parser.add_argument("--prefix", default="arm-none-eabi-", help="toolchain prefix of objdump and nm")
+    args = parser.parse_args()
+    sys.exit(1 if report(args.elf, args.map, args.prefix + "objdump", args.prefix + "nm", args.flash, args.ram,
+                         parse_module_budgets("\n".join(args.module)), args.top) else 0)
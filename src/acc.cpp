@@ -15,6 +15,158 @@ void acc_int_callback(void);
 /** The LIS3DH sensor */
 LIS3DH acc_sensor(I2C_MODE, 0x18);
 
+/** Number of samples taken to measure the noise floor */
+#define ACC_CAL_SAMPLES 32
+/** Threshold limits, 1 LSB = 16 mg at +/-2g */
+#define ACC_THS_MIN 0x02
+#define ACC_THS_MAX 0x20
+/** INT1_THS and ACT_THS hold 7 bits */
+#define ACC_THS_REG_MAX 0x7F
+/** Inactivity time before the sensor reports parked, 1 LSB = 8 / ODR = 0.8 s */
+#define ACC_ACT_DUR 75
+/** Window to count false wakeups, 1 hour */
+#define ACC_WAKE_WINDOW 3600000
+
+/** Wakeup threshold from the last calibration */
+uint8_t acc_cal_ths = 0x03;
+/** Wakeup threshold in use */
+uint8_t acc_ths = 0x03;
+/** Wakeup duration in use, 1 LSB = 1 / ODR = 100 ms */
+uint8_t acc_duration = 0x01;
+/** Peak to peak noise measured in the last calibration */
+uint8_t acc_noise = 0;
+
+/** Wakeups without movement in the current window */
+uint16_t acc_false_wakes = 0;
+/** Start of the current false wakeup window */
+time_t acc_window_start = 0;
+/** Time of the last wakeup */
+time_t acc_last_wake = 0;
+
+/**
+ * @brief Write threshold and duration of the wakeup interrupt.
+ *        Activity threshold follows the wakeup threshold.
+ *
+ */
+void acc_write_threshold(void)
+{
+	acc_ths = acc_ths > ACC_THS_REG_MAX ? ACC_THS_REG_MAX : acc_ths;
+	acc_sensor.writeRegister(LIS3DH_INT1_THS, acc_ths);
+	acc_sensor.writeRegister(LIS3DH_INT1_DURATION, acc_duration);
+	acc_sensor.writeRegister(LIS3DH_ACT_THS, acc_ths);
+	MYLOG("ACC", "Threshold 0x%02X duration %d", acc_ths, acc_duration);
+}
+
+/**
+ * @brief Measure the noise floor with the sensor at rest and
+ *        derive threshold and duration of the wakeup interrupt.
+ *        The sensor runs in 8 bit low power mode, 1 LSB = 16 mg.
+ *
+ * @return uint8_t peak to peak noise of the noisiest axis
+ */
+uint8_t acc_calibrate(void)
+{
+	int8_t min_val[3] = {127, 127, 127};
+	int8_t max_val[3] = {-128, -128, -128};
+
+	for (int idx = 0; idx < ACC_CAL_SAMPLES; idx++)
+	{
+		// 8 bit data is left aligned in the 16 bit output registers
+		int8_t sample[3];
+		sample[0] = acc_sensor.readRawAccelX() >> 8;
+		sample[1] = acc_sensor.readRawAccelY() >> 8;
+		sample[2] = acc_sensor.readRawAccelZ() >> 8;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			min_val[axis] = sample[axis] < min_val[axis] ? sample[axis] : min_val[axis];
+			max_val[axis] = sample[axis] > max_val[axis] ? sample[axis] : max_val[axis];
+		}
+		// One sample per ODR period
+		delay(100);
+	}
+
+	uint8_t noise = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		uint8_t axis_noise = max_val[axis] - min_val[axis];
+		noise = axis_noise > noise ? axis_noise : noise;
+	}
+
+	// Threshold above the noise peak, vibrating mounts need a longer event as well
+	acc_noise = noise;
+	// Noise can reach 255 LSB on a shaking mount, add the margin without wrapping
+	uint16_t cal_ths = (uint16_t)noise + ACC_THS_MIN;
+	cal_ths = cal_ths > ACC_THS_MAX ? ACC_THS_MAX : cal_ths;
+	acc_cal_ths = (uint8_t)cal_ths;
+	acc_ths = acc_cal_ths;
+	acc_duration = noise > 2 ? 3 : 1;
+	acc_write_threshold();
+
+	acc_false_wakes = 0;
+	acc_window_start = millis();
+
+	MYLOG("ACC", "Noise floor %d, threshold 0x%02X", noise, acc_ths);
+	return noise;
+}
+
+/**
+ * @brief Feedback after a wakeup, did the position change?
+ *        If more wakeups than allowed per hour did not move the device,
+ *        the threshold is raised. A quiet hour lowers it again down to
+ *        the calibrated value.
+ *
+ * @param moved true if the fix after the wakeup showed movement
+ */
+void acc_wake_result(bool moved)
+{
+	if (!moved)
+	{
+		acc_false_wakes++;
+	}
+
+	if (acc_false_wakes > g_mapper_settings.acc_false_wakes)
+	{
+		if (acc_ths < ACC_THS_MAX)
+		{
+			acc_ths++;
+			acc_write_threshold();
+			MYLOG("ACC", "Too many false wakeups, raise threshold");
+		}
+		acc_false_wakes = 0;
+		acc_window_start = millis();
+	}
+	else if ((millis() - acc_window_start) > ACC_WAKE_WINDOW)
+	{
+		if ((acc_false_wakes == 0) && (acc_ths > acc_cal_ths))
+		{
+			acc_ths--;
+			acc_write_threshold();
+			MYLOG("ACC", "No false wakeups, lower threshold");
+		}
+		acc_false_wakes = 0;
+		acc_window_start = millis();
+	}
+}
+
+/**
+ * @brief Check if the device is parked, no activity for ACC_ACT_DUR.
+ *        Read from the sensor state on INT2 if it is wired,
+ *        otherwise derived from the time of the last wakeup. INT1 is
+ *        latched, the tracker re-arms it on every poll.
+ *
+ * @return true no activity
+ * @return false device is moving
+ */
+bool acc_is_parked(void)
+{
+#ifdef INT2_PIN
+	// INT2 is high while the sensor is in inactive state
+	return digitalRead(INT2_PIN) == HIGH;
+#else
+	return (millis() - acc_last_wake) > (ACC_ACT_DUR * 800);
+#endif
+}
+
 /**
  * @brief Initialize LIS3DH 3-axis 
  * acceleration sensor
@@ -44,6 +196,9 @@ bool init_acc(void)
 		return false;
 	}
 
+	// Switch to 8 bit low power mode, 10 Hz, x, y and z enabled
+	acc_sensor.writeRegister(LIS3DH_CTRL_REG1, 0x2F);
+
 	uint8_t data_to_write = 0;
 	// Enable interrupts
 	data_to_write |= 0x20;									  //Z high
@@ -51,19 +206,7 @@ bool init_acc(void)
 	data_to_write |= 0x02;									  //X high
 	acc_sensor.writeRegister(LIS3DH_INT1_CFG, data_to_write); // Enable interrupts on high tresholds for x, y and z
 
-	// Set interrupt trigger range
-	data_to_write = 0;
-	//data_to_write |= 0x10;									  // 1/8 range
-	//acc_sensor.writeRegister(LIS3DH_INT1_THS, data_to_write); // 1/8th range
-	// data_to_write |= 0x08;									  // 1/16 range
-	// acc_sensor.writeRegister(LIS3DH_INT1_THS, data_to_write); // 1/16th range
-	data_to_write |= 0x03;									      // A lower threshold for mapping purposes
-	acc_sensor.writeRegister(LIS3DH_INT1_THS, data_to_write); 
-
-	// Set interrupt signal length
-	data_to_write = 0;
-	data_to_write |= 0x01; // 1 * 1/50 s = 20ms
-	acc_sensor.writeRegister(LIS3DH_INT1_DURATION, data_to_write);
+	// Interrupt threshold and duration are set by the calibration
 
 	acc_sensor.readRegister(&data_to_write, LIS3DH_CTRL_REG5);
 	data_to_write &= 0xF3;									   //Clear bits of interest
@@ -76,16 +219,25 @@ bool init_acc(void)
 	data_to_write |= 0x20; //AOI2 event ()
 	acc_sensor.writeRegister(LIS3DH_CTRL_REG3, data_to_write);
 
-	// No interrupt on pin 2
-	acc_sensor.writeRegister(LIS3DH_CTRL_REG6, 0x00); 
+	// Activity/inactivity state on pin 2
+	acc_sensor.writeRegister(LIS3DH_CTRL_REG6, 0x08);
+
+	// Inactivity time before the sensor goes to sleep state
+	acc_sensor.writeRegister(LIS3DH_ACT_DUR, ACC_ACT_DUR);
 
 	// Enable high pass filter
 	acc_sensor.writeRegister(LIS3DH_CTRL_REG2, 0x01); 
 
+	// Measure the noise floor and set the thresholds
+	acc_calibrate();
+
 	clear_acc_int();
 
 	// Set the interrupt callback function
 	attachInterrupt(INT1_PIN, acc_int_callback, RISING);
+#ifdef INT2_PIN
+	pinMode(INT2_PIN, INPUT);
+#endif
 	
 	return true;
 }
@@ -110,6 +262,7 @@ void read_acc(void)
 void acc_int_callback(void)
 {
 	g_task_event_type |= ACC_TRIGGER;
+	acc_last_wake = millis();
     MYLOG("ACC", "interrupt callback");
 	xSemaphoreGiveFromISR(g_task_sem, pdFALSE);
 }
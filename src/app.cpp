@@ -12,6 +12,7 @@
  */
 
 #include "app.h"
+#include "geo.h"
 
 /** Set the device name, max length is 10 characters */
 char g_ble_dev_name[10] = "WB-Mapper";
@@ -26,8 +27,11 @@ SoftwareTimer delayed_sending;
 /** Required for give semaphore from ISR */
 BaseType_t g_higher_priority_task_woken = pdTRUE;
 
-/** Battery level uinion */
-batt_s batt_level;
+/** Battery level in mV */
+uint16_t batt_level;
+
+/** Uplink payload buffer */
+uint8_t tx_payload[PAYLOAD_MAX_LEN];
 
 /** Flag if delayed sending is already activated */
 bool delayed_active = false;
@@ -38,8 +42,36 @@ time_t min_delay = 45000;
 /** The GPS module to use */
 uint8_t gnss_option;
 
-// Forward declaration
+/** Flag if the accelerometer reported motion since the last valid fix */
+bool motion_since_fix = true;
+
+/** Flag if a valid fix is cached */
+bool fix_cached = false;
+
+/** Time the cached fix was acquired */
+time_t last_fix_time = 0;
+
+/** Flag if a fix waits for the TX cycle of an empty frame to finish */
+bool fit_pending = false;
+
+/** Fix that did not fit the DR with the pending MAC commands */
+gnss_fix_s fit_pending_fix;
+
+/** Slower movement between two fixes is GNSS noise, in mm/s */
+#define MOVE_MIN_SPEED 500
+/** Horizontal error per 1.0 HDOP in mm */
+#define MOVE_UERE_MM 3000
+/** Smallest noise floor in mm */
+#define MOVE_MIN_NOISE_MM 5000
+/** A position change above this is always movement, in mm */
+#define MOVE_MAX_MM 30000
+
+// Forward declarations
 void send_delayed(TimerHandle_t unused);
+uint8_t encode_position(gnss_fix_s &fix, uint8_t *buf, uint8_t &fport);
+bool payload_fits(uint8_t len, uint8_t &max_len);
+void send_position(gnss_fix_s &fix, bool follow_up);
+bool fix_moved(gnss_fix_s &from, gnss_fix_s &to, uint32_t elapsed_ms);
 
 /**
  * @brief Application specific setup functions
@@ -148,6 +180,24 @@ bool init_app(void)
 	AT_PRINTF("WisBlock Helium Mapper");
 	AT_PRINTF("======================");
 
+	// Read application settings
+	init_mapper_settings();
+
+	// Read the filter of covered cells
+	init_coverage();
+
+	// Read the exclusion zones
+	init_zones();
+
+	// Prepare the survey burst timer
+	init_survey();
+
+	// Start the distance trigger
+	init_trigger();
+
+	// Select the GNSS profile, init_gnss() writes it to the module
+	gnss_profile_restart();
+
 	// Initialize GNSS module
 	gnss_option = init_gnss();
 
@@ -184,6 +234,209 @@ bool init_app(void)
 	return init_result;
 }
 
+/**
+ * @brief Encode a position and the battery level in the
+ *        configured uplink format, or in the compact format
+ *        if the configured one does not fit the current DR
+ *
+ * @param fix position to send
+ * @param buf payload buffer, PAYLOAD_MAX_LEN bytes
+ * @param fport set to the port of the format
+ * @return uint8_t payload length, 0 if no format fits
+ */
+uint8_t encode_position(gnss_fix_s &fix, uint8_t *buf, uint8_t &fport)
+{
+	payload_values_s values;
+	values.lat_e7 = fix.lat_e7;
+	values.lon_e7 = fix.lon_e7;
+	values.alt_mm = fix.alt_mm;
+	values.hdop_e2 = fix.hdop_e2;
+	values.sats = fix.sats;
+	values.batt_mv = batt_level;
+
+#if MAPPER_PAYLOAD_FORMAT == 2
+	typedef payload_v2 payload_full;
+#else
+	typedef payload_v1 payload_full;
+#endif
+
+	// Pick the richest format that fits the current DR and the pending MAC commands
+	uint8_t max_len = 0;
+	if (payload_fits(payload_full::size, max_len))
+	{
+		fport = payload_full::fport;
+		return payload_full::encode(buf, values);
+	}
+	if (max_len >= payload_compact::size)
+	{
+		MYLOG("APP", "Only %d bytes possible, send compact fix", max_len);
+		fport = payload_compact::fport;
+		return payload_compact::encode(buf, values);
+	}
+	MYLOG("APP", "Only %d bytes possible, no format fits", max_len);
+	return 0;
+}
+
+/**
+ * @brief Check if a payload can be sent with the current DR.
+ *        Pending MAC commands reduce the possible size.
+ *
+ * @param len payload length
+ * @param max_len set to the maximum possible payload length
+ * @return true payload fits
+ * @return false payload is too long
+ */
+bool payload_fits(uint8_t len, uint8_t &max_len)
+{
+	LoRaMacTxInfo_t tx_info;
+	tx_info.MaxPossiblePayload = 0;
+	bool fits = LoRaMacQueryTxPossible(len, &tx_info) == LORAMAC_STATUS_OK;
+	max_len = tx_info.MaxPossiblePayload;
+	return fits;
+}
+
+/**
+ * @brief Send a fix in the richest format that fits the current DR.
+ *        If no format fits, an empty frame is sent to flush the pending
+ *        MAC commands and the fix follows when that TX cycle is finished.
+ *
+ * @param fix position to send
+ * @param follow_up true if the MAC commands were already flushed for this fix
+ */
+void send_position(gnss_fix_s &fix, bool follow_up)
+{
+	// A newer fix replaces one that waits for the flush
+	fit_pending = false;
+
+	uint8_t fport = 0;
+	uint8_t payload_len = encode_position(fix, tx_payload, fport);
+	if (payload_len != 0)
+	{
+		send_payload(tx_payload, payload_len, fport);
+		return;
+	}
+
+	if (follow_up)
+	{
+		AT_PRINTF("+EVT:FIT DROP")
+		MYLOG("APP", "Fix does not fit the current DR, dropped");
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.print("Fix does not fit the current DR, dropped\n");
+		}
+		return;
+	}
+
+	AT_PRINTF("+EVT:FIT FLUSH")
+	MYLOG("APP", "Send empty frame, fix follows");
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.print("Send empty frame, fix follows\n");
+	}
+	// On LMH_ERROR the stack already sent an empty frame to flush the MAC commands
+	if (send_payload(tx_payload, 0, 0) != LMH_BUSY)
+	{
+		fit_pending_fix = fix;
+		fit_pending = true;
+	}
+}
+
+/**
+ * @brief Send interval with the factors of the link quality
+ *        feedback and the battery policy applied
+ *
+ * @return uint32_t send interval in ms, 0 if periodic sending is off
+ */
+uint32_t send_interval(void)
+{
+	uint32_t factor = (uint32_t)link_interval_factor() * batt_interval_factor();
+	// Longest interval is one day
+	uint32_t interval = g_lorawan_settings.send_repeat_time * factor;
+	return (interval / factor != g_lorawan_settings.send_repeat_time) || (interval > 86400000) ? 86400000 : interval;
+}
+
+/**
+ * @brief Check if the position changed between two fixes. The limit is
+ *        the error of both fixes from their HDOP or MOVE_MIN_SPEED over the
+ *        elapsed time, whichever is larger, so a slow walk between two close
+ *        fixes counts as movement. It never exceeds MOVE_MAX_MM.
+ *
+ * @param from older fix
+ * @param to newer fix
+ * @param elapsed_ms time between the fixes
+ * @return true position changed
+ * @return false same position within GNSS noise
+ */
+bool fix_moved(gnss_fix_s &from, gnss_fix_s &to, uint32_t elapsed_ms)
+{
+	uint32_t dist_mm;
+	uint16_t bearing;
+	geo_delta(from.lat_e7, from.lon_e7, to.lat_e7, to.lon_e7, dist_mm, bearing);
+
+	uint32_t limit_mm = ((uint32_t)from.hdop_e2 + to.hdop_e2) * MOVE_UERE_MM / 100;
+	limit_mm = limit_mm < MOVE_MIN_NOISE_MM ? MOVE_MIN_NOISE_MM : limit_mm;
+	uint64_t slow_mm = (uint64_t)elapsed_ms * MOVE_MIN_SPEED / 1000;
+	limit_mm = slow_mm > limit_mm ? (uint32_t)(slow_mm > MOVE_MAX_MM ? MOVE_MAX_MM : slow_mm) : limit_mm;
+	limit_mm = limit_mm > MOVE_MAX_MM ? MOVE_MAX_MM : limit_mm;
+	return dist_mm > limit_mm;
+}
+
+/**
+ * @brief Enqueue a payload for sending
+ *
+ * @param buf payload
+ * @param len payload length
+ * @param fport LoRaWAN port, 0 = configured application port
+ * @return lmh_error_status result of send_lora_packet()
+ */
+lmh_error_status send_payload(uint8_t *buf, uint8_t len, uint8_t fport)
+{
+	for (int idx = 0; idx < len; idx++)
+	{
+		MYLOG("APP", "Payload %d: %02X", idx, buf[idx]);
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.printf("Payload %d: %02X\n", idx, buf[idx]);
+		}
+	}
+
+	// Probe the link quality now and then. Confirmed uplinks can be off on a weak link,
+	// the setting is changed only while the packet is enqueued so save_settings() never stores it.
+	bool confirmed = g_lorawan_settings.confirmed_msg_enabled;
+	g_lorawan_settings.confirmed_msg_enabled = link_before_tx(len);
+	lmh_error_status result = send_lora_packet(buf, len, fport);
+	g_lorawan_settings.confirmed_msg_enabled = confirmed;
+	switch (result)
+	{
+	case LMH_SUCCESS:
+		batt_uplink();
+		MYLOG("APP", "Packet enqueued");
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.print("Packet enqueued\n");
+		}
+		/// \todo set a flag that TX cycle is running
+		lora_busy = true;
+
+		break;
+	case LMH_BUSY:
+		MYLOG("APP", "LoRa transceiver is busy");
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.print("LoRa transceiver is busy\n");
+		}
+		break;
+	case LMH_ERROR:
+		MYLOG("APP", "Packet error, too big to send with current DR");
+		if (g_ble_uart_is_connected)
+		{
+			g_ble_uart.print("Packet error, too big to send with current DR\n");
+		}
+		break;
+	}
+	return result;
+}
+
 /**
  * @brief Application specific event handler
  *        Requires as minimum the handling of STATUS event
@@ -191,6 +444,8 @@ bool init_app(void)
  */
 void app_event_handler(void)
 {
+	mem_sample();
+
 	// Timer triggered event
 	if ((g_task_event_type & STATUS) == STATUS)
 	{
@@ -204,6 +459,9 @@ void app_event_handler(void)
 
 		clear_acc_int();
 
+		// Started by the distance trigger, a skipped event is not repeated
+		bool triggered = trigger_fired();
+
 		// If BLE is enabled, restart Advertising
 		if (g_enable_ble)
 		{
@@ -218,99 +476,139 @@ void app_event_handler(void)
 				g_ble_uart.print("LoRaWAN TX cycle not finished, skip this event\n");
 			}
 		}
+		else if (survey_active())
+		{
+			MYLOG("APP", "Survey burst running, skip this event");
+			if (g_ble_uart_is_connected)
+			{
+				g_ble_uart.print("Survey burst running, skip this event\n");
+			}
+		}
 		else
 		{
 			// Get battery level
-			batt_level.batt16 = read_batt();
-			g_mapper_data.batt_1 = batt_level.batt8[0];
-			g_mapper_data.batt_2 = batt_level.batt8[1];
+			batt_level = batt_update(read_batt());
 
-			MYLOG("APP", "Battery level %d", batt_level.batt16);
-			MYLOG("APP", "Trying to poll GNSS position");
+			MYLOG("APP", "Battery level %d", batt_level);
 			if (g_ble_uart_is_connected)
 			{
-				g_ble_uart.printf("Battery: %.2f V\n", batt_level.batt16 / 1000.0);
-				g_ble_uart.print("Trying to poll GNSS position\n");
+				g_ble_uart.printf("Battery: %.2f V %d%%\n", batt_level / 1000.0, batt_soc_pm() / 10);
 			}
 
-			if (poll_gnss(gnss_option))
+			// Reuse the cached fix if the device did not move since it was acquired, longer on low battery.
+			// The distance trigger always sends a new position.
+			time_t fix_age = millis() - last_fix_time;
+			if (!triggered && !motion_since_fix && fix_cached && (g_mapper_settings.still_mode != STILL_POLL) &&
+				((int64_t)fix_age < (int64_t)g_mapper_settings.fix_cache_time * 1000 * batt_interval_factor()))
 			{
-				AT_PRINTF("+EVT:LOCATION OK")
-				MYLOG("APP", "Valid GNSS position acquired");
-				if (g_ble_uart_is_connected)
+				if (g_mapper_settings.still_mode == STILL_HEARTBEAT)
 				{
-					g_ble_uart.print("Valid GNSS position acquired\n");
-				}
-
-				MYLOG("APP", "Lat 1: %02X", g_mapper_data.lat_1);
-				MYLOG("APP", "Lat 2: %02X", g_mapper_data.lat_2);
-				MYLOG("APP", "Lat 3: %02X", g_mapper_data.lat_3);
-				MYLOG("APP", "Lat 4: %02X", g_mapper_data.lat_4);
-				MYLOG("APP", "Long 1: %02X", g_mapper_data.long_1);
-				MYLOG("APP", "Long 2: %02X", g_mapper_data.long_2);
-				MYLOG("APP", "Long 3: %02X", g_mapper_data.long_3);
-				MYLOG("APP", "Long 4: %02X", g_mapper_data.long_4);
-				MYLOG("APP", "Alt 1: %02X", g_mapper_data.alt_1);
-				MYLOG("APP", "Alt 2: %02X", g_mapper_data.alt_2);
-				MYLOG("APP", "Acy 1: %02X", g_mapper_data.acy_1);
-				MYLOG("APP", "Acy 2: %02X", g_mapper_data.acy_2);
-				MYLOG("APP", "Batt 1: %02X", g_mapper_data.batt_1);
-				MYLOG("APP", "Batt 2: %02X", g_mapper_data.batt_2);
+					AT_PRINTF("+EVT:STILL HEARTBEAT")
+					MYLOG("APP", "No motion, send cached position, age %lds", (long)(fix_age / 1000));
+					if (g_ble_uart_is_connected)
+					{
+						g_ble_uart.printf("No motion, send cached position, age %lds\n", (long)(fix_age / 1000));
+					}
 
+					gnss_fix_s send_fix = g_last_fix;
+					uint8_t max_len = 0;
+					if (!zones_apply(send_fix))
+					{
+						AT_PRINTF("+EVT:ZONE SKIP")
+					}
+					else if (payload_fits(payload_still::size, max_len))
+					{
+						payload_values_s values;
+						values.lat_e7 = send_fix.lat_e7;
+						values.lon_e7 = send_fix.lon_e7;
+						values.age_min = fix_age / 60000;
+						values.batt_mv = batt_level;
+						send_payload(tx_payload, payload_still::encode(tx_payload, values), payload_still::fport);
+					}
+					else
+					{
+						// Heartbeat does not fit the current DR, send the cached fix in a smaller format
+						send_position(send_fix, false);
+					}
+				}
+				else
+				{
+					AT_PRINTF("+EVT:STILL SKIP")
+					MYLOG("APP", "No motion, skip uplink");
+					if (g_ble_uart_is_connected)
+					{
+						g_ble_uart.print("No motion, skip uplink\n");
+					}
+				}
+			}
+			else
+			{
+				MYLOG("APP", "Trying to poll GNSS position");
 				if (g_ble_uart_is_connected)
 				{
-					g_ble_uart.printf("Lat 1: %02X\n", g_mapper_data.lat_1);
-					g_ble_uart.printf("Lat 2: %02X\n", g_mapper_data.lat_2);
-					g_ble_uart.printf("Lat 3: %02X\n", g_mapper_data.lat_3);
-					g_ble_uart.printf("Lat 4: %02X\n", g_mapper_data.lat_4);
-					g_ble_uart.printf("Long 1: %02X\n", g_mapper_data.long_1);
-					g_ble_uart.printf("Long 2: %02X\n", g_mapper_data.long_2);
-					g_ble_uart.printf("Long 3: %02X\n", g_mapper_data.long_3);
-					g_ble_uart.printf("Long 4: %02X\n", g_mapper_data.long_4);
-					g_ble_uart.printf("Alt 1: %02X\n", g_mapper_data.alt_1);
-					g_ble_uart.printf("Alt 2: %02X\n", g_mapper_data.alt_2);
-					g_ble_uart.printf("Acy 1: %02X\n", g_mapper_data.acy_1);
-					g_ble_uart.printf("Acy 2: %02X\n", g_mapper_data.acy_2);
-					g_ble_uart.printf("Batt 1: %02X\n", g_mapper_data.batt_1);
-					g_ble_uart.printf("Batt 2: %02X\n", g_mapper_data.batt_2);
+					g_ble_uart.print("Trying to poll GNSS position\n");
 				}
 
-				lmh_error_status result = send_lora_packet((uint8_t *)&g_mapper_data, MAPPER_DATA_LEN);
-				switch (result)
+				gnss_fix_s prev_fix = g_last_fix;
+				bool check_wake = fix_cached && motion_since_fix;
+				// A recent fix of the distance trigger is used as is, saves a GNSS poll
+				if (trigger_take_fix(g_last_fix) || poll_gnss(gnss_option, g_last_fix))
 				{
-				case LMH_SUCCESS:
-					MYLOG("APP", "Packet enqueued");
+					AT_PRINTF("+EVT:LOCATION OK")
+					MYLOG("APP", "Valid GNSS position acquired");
 					if (g_ble_uart_is_connected)
 					{
-						g_ble_uart.print("Packet enqueued\n");
+						g_ble_uart.print("Valid GNSS position acquired\n");
 					}
-					/// \todo set a flag that TX cycle is running
-					lora_busy = true;
 
-					break;
-				case LMH_BUSY:
-					MYLOG("APP", "LoRa transceiver is busy");
-					if (g_ble_uart_is_connected)
+					// Tell the accelerometer if the wakeup was a real movement
+					if (check_wake)
 					{
-						g_ble_uart.print("LoRa transceiver is busy\n");
+						acc_wake_result(fix_moved(prev_fix, g_last_fix, millis() - last_fix_time));
 					}
-					break;
-				case LMH_ERROR:
-					MYLOG("APP", "Packet error, too big to send with current DR");
-					if (g_ble_uart_is_connected)
+
+					// Start a new stationary period with this fix
+					motion_since_fix = false;
+					fix_cached = true;
+					last_fix_time = millis();
+
+					// Distance and heading are measured from here
+					trigger_anchor(g_last_fix);
+
+					gnss_fix_s send_fix = g_last_fix;
+					if (!zones_apply(send_fix))
 					{
-						g_ble_uart.print("Packet error, too big to send with current DR\n");
+						AT_PRINTF("+EVT:ZONE SKIP")
+						if (g_ble_uart_is_connected)
+						{
+							g_ble_uart.print("Position in exclusion zone, skip uplink\n");
+						}
+					}
+					else if (survey_start(send_fix))
+					{
+						// The burst sends the fix on all survey data rates
+					}
+					else if (coverage_should_send(send_fix))
+					{
+						send_position(send_fix, false);
+					}
+					else
+					{
+						AT_PRINTF("+EVT:COVERED SKIP")
+						if (g_ble_uart_is_connected)
+						{
+							g_ble_uart.print("Cell is covered, skip uplink\n");
+						}
 					}
-					break;
 				}
-			}
-			else
-			{
-				AT_PRINTF("+EVT:LOCATION FAIL")
-				MYLOG("APP", "No valid GNSS position");
-				if (g_ble_uart_is_connected)
+				else
 				{
-					g_ble_uart.print("No valid GNSS position\n");
+					AT_PRINTF("+EVT:LOCATION FAIL")
+					MYLOG("APP", "No valid GNSS position");
+					if (g_ble_uart_is_connected)
+					{
+						g_ble_uart.print("No valid GNSS position\n");
+					}
 				}
 			}
 
@@ -321,19 +619,36 @@ void app_event_handler(void)
 		}
 	}
 
+	// Distance trigger GNSS poll
+	if ((g_task_event_type & TRACK_TRIGGER) == TRACK_TRIGGER)
+	{
+		g_task_event_type &= N_TRACK_TRIGGER;
+		trigger_track();
+	}
+
+	// Survey burst timer event
+	if ((g_task_event_type & SURVEY_TRIGGER) == SURVEY_TRIGGER)
+	{
+		g_task_event_type &= N_SURVEY_TRIGGER;
+		survey_next();
+	}
+
 	// ACC trigger event
 	if ((g_task_event_type & ACC_TRIGGER) == ACC_TRIGGER && g_lpwan_has_joined)
 	{
 		g_task_event_type &= N_ACC_TRIGGER;
+		motion_since_fix = true;
+		gnss_profile_motion();
 		MYLOG("APP", "ACC triggered");
 		if (g_ble_uart_is_connected)
 		{
 			g_ble_uart.print("ACC triggered\n");
 		}
 
-		// Check time since last send
-		bool send_now = true;
-		if (g_lorawan_settings.send_repeat_time != 0)
+		// Check time since last send. In trigger mode the distance trigger
+		// sends while moving and the timer keeps its period.
+		bool send_now = !g_mapper_settings.trigger_mode;
+		if ((g_lorawan_settings.send_repeat_time != 0) && send_now)
 		{
 			if ((millis() - last_pos_send) < min_delay)
 			{
@@ -375,10 +690,10 @@ void app_event_handler(void)
 			g_task_event_type |= STATUS;
 		}
 
-		// Reset the standard timer
-		if (g_lorawan_settings.send_repeat_time != 0)
+		// Reset the standard timer, stretched on a weak link or low battery
+		if ((g_lorawan_settings.send_repeat_time != 0) && !g_mapper_settings.trigger_mode)
 		{
-			api_timer_restart(g_lorawan_settings.send_repeat_time);
+			api_timer_restart(send_interval());
 		}
 	}
 }
@@ -466,14 +781,29 @@ void lora_data_handler(void)
 					// Save the new send interval
 					g_lorawan_settings.send_repeat_time = new_send_interval * 1000;
 
-					// Set the timer to the new send interval
-					api_timer_restart(g_lorawan_settings.send_repeat_time);
+					// Set the timer to the new send interval, stretched on a weak link or low battery
+					api_timer_restart(send_interval());
 					// Save the new send interval
 					save_settings();
 				}
 			}
 		}
 
+		// Feed the link quality estimation
+		link_rx(g_last_rssi, g_last_snr, g_rx_data_len);
+
+		// Check if downlink is a coverage filter update
+		if (g_last_fport == COVERAGE_FPORT)
+		{
+			coverage_downlink(g_rx_lora_data, g_rx_data_len);
+		}
+
+		// Check if downlink is a survey mode command
+		if (g_last_fport == SURVEY_FPORT)
+		{
+			survey_downlink(g_rx_lora_data, g_rx_data_len);
+		}
+
 		char rx_data[512];
 		for (int idx = 0; idx < g_rx_data_len; idx++)
 		{
@@ -495,7 +825,7 @@ void lora_data_handler(void)
 		/**************************************************************/
 		g_task_event_type &= N_LORA_TX_FIN;
 
-		if ((g_lorawan_settings.confirmed_msg_enabled) && (g_lorawan_settings.lorawan_enable))
+		if ((link_tx_confirmed()) && (g_lorawan_settings.lorawan_enable))
 		{
 			AT_PRINTF("+EVT:SEND CONFIRMED %s\n", g_rx_fin_result ? "SUCCESS" : "FAIL");
 		}
@@ -506,6 +836,18 @@ void lora_data_handler(void)
 
 		/// \todo reset flag that TX cycle is running
 		lora_busy = false;
+
+		// Adapt DR, confirmed uplinks and send interval to the link quality
+		link_tx_finished(g_rx_fin_result);
+
+		// Schedule the next uplink of a survey burst
+		survey_tx_finished();
+
+		// Send the fix that did not fit before the MAC commands were flushed
+		if (fit_pending)
+		{
+			send_position(fit_pending_fix, true);
+		}
 	}
 }
 
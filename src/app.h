@@ -49,6 +49,10 @@ void lora_rx_failed(void);
 /** Examples for application events */
 #define ACC_TRIGGER 0b1000000000000000
 #define N_ACC_TRIGGER 0b0111111111111111
+#define SURVEY_TRIGGER 0b0100000000000000
+#define N_SURVEY_TRIGGER 0b1011111111111111
+#define TRACK_TRIGGER 0b0010000000000000
+#define N_TRACK_TRIGGER 0b1101111111111111
 
 /** Application stuff */
 extern BaseType_t g_higher_priority_task_woken;
@@ -56,53 +60,189 @@ extern BaseType_t g_higher_priority_task_woken;
 // GNSS options
 #define RAK1910_GNSS 1
 #define RAK12500_GNSS 2
+#define REPLAY_GNSS 3
+
+// Set to 1 to use the replay backend instead of a real GNSS module
+#ifndef GNSS_REPLAY
+#define GNSS_REPLAY 0
+#endif
+
+/** GNSS fix as delivered by the backends, fixed point */
+struct gnss_fix_s
+{
+	int32_t lat_e7 = 0;	  // Latitude in 1e-7 degrees
+	int32_t lon_e7 = 0;	  // Longitude in 1e-7 degrees
+	int32_t alt_mm = 0;	  // Altitude in millimeters
+	uint16_t hdop_e2 = 0; // HDOP * 100
+	uint8_t sats = 0;	  // Satellites used in fix
+};
 
 // GNSS functions
-#include "TinyGPS++.h"
-#include <SoftwareSerial.h>
-#include <SparkFun_u-blox_GNSS_Arduino_Library.h> // RAK12500_GNSS
 uint8_t init_gnss(void);
-bool poll_gnss(uint8_t gnss_option);
+bool poll_gnss(uint8_t gnss_option, gnss_fix_s &result);
+
+// GNSS configuration profiles
+#define GNSS_PROFILE_STATIONARY 0
+#define GNSS_PROFILE_PEDESTRIAN 1
+#define GNSS_PROFILE_AUTOMOTIVE 2
+#define GNSS_PROFILE_NUM 3
+#define GNSS_PROFILE_AUTO 3 // Selected from the motion state
+
+/** Dynamic platform models, values of the u-blox CFG-NAV5 dynModel */
+#define GNSS_DYN_STATIONARY 2
+#define GNSS_DYN_PEDESTRIAN 3
+#define GNSS_DYN_AUTOMOTIVE 4
+
+/** Constellations, bit number is the u-blox gnssId */
+#define GNSS_SYS_GPS 0x01
+#define GNSS_SYS_SBAS 0x02
+#define GNSS_SYS_GALILEO 0x04
+#define GNSS_SYS_BEIDOU 0x08
+#define GNSS_SYS_QZSS 0x20
+#define GNSS_SYS_GLONASS 0x40
+
+/** One GNSS configuration profile */
+struct gnss_profile_s
+{
+	const char *name;
+	uint8_t dyn_model; // GNSS_DYN_*
+	uint16_t meas_ms;  // Measurement period in ms
+	uint8_t nav_rate;  // Measurements per navigation solution
+	uint8_t systems;   // GNSS_SYS_* bits
+};
+void gnss_profile_restart(void);
+const gnss_profile_s &gnss_profile(void);
+void gnss_profile_motion(void);
+void gnss_profile_fix(const gnss_fix_s &fix);
 
 /** Accelerometer stuff */
 #include <SparkFunLIS3DH.h>
 #define INT1_PIN WB_IO5
+// Define INT2_PIN if INT2 of the LIS3DH is wired, it signals the parked state
 bool init_acc(void);
 void clear_acc_int(void);
 void read_acc(void);
+uint8_t acc_calibrate(void);
+void acc_wake_result(bool moved);
+bool acc_is_parked(void);
+extern uint8_t acc_ths;
+extern uint8_t acc_duration;
+extern uint8_t acc_noise;
 
 // LoRaWan functions
-struct mapper_data_s
-{
-	uint8_t lat_1 = 0;	// 1
-	uint8_t lat_2 = 0;	// 2
-	uint8_t lat_3 = 0;	// 3
-	uint8_t lat_4 = 0;	// 4
-	uint8_t long_1 = 0; // 5
-	uint8_t long_2 = 0; // 6
-	uint8_t long_3 = 0; // 7
-	uint8_t long_4 = 0; // 8
-	uint8_t alt_1 = 0;	// 9
-	uint8_t alt_2 = 0;	// 10
-	uint8_t acy_1 = 0;	// 11
-	uint8_t acy_2 = 0;	// 12
-	uint8_t batt_1 = 0; // 13
-	uint8_t batt_2 = 0; // 14
-};
-extern mapper_data_s g_mapper_data;
-#define MAPPER_DATA_LEN 14 // sizeof(g_mapper_data)
+#include "payload.h"
+// Uplink payload format, 1 = original 14 byte layout, 2 = full precision on MAPPER_FPORT_V2
+#ifndef MAPPER_PAYLOAD_FORMAT
+#define MAPPER_PAYLOAD_FORMAT 1
+#endif
+extern gnss_fix_s g_last_fix;
+extern bool lora_busy;
+extern time_t last_pos_send;
+extern time_t min_delay;
+extern uint8_t gnss_option;
+uint32_t send_interval(void);
+void lora_dr_params(uint8_t dr, uint8_t &sf, uint16_t &bw_khz);
+uint32_t lora_airtime(uint8_t dr, uint8_t len);
+bool lora_duty_limited(void);
+uint8_t lora_current_dr(void);
+uint8_t lora_rx_dr(uint32_t elapsed_ms, uint8_t up_dr, uint8_t up_len, uint8_t down_len);
+lmh_error_status send_payload(uint8_t *buf, uint8_t len, uint8_t fport);
 
-/** Battery level uinion */
-union batt_s
-{
-	uint16_t batt16 = 0;
-	uint8_t batt8[2];
-};
-/** Latitude/Longitude value union */
-union latLong_s
+// Stationary handling, what a timer tick does if no motion since the last fix
+#define STILL_POLL 0	  // Always poll GNSS
+#define STILL_HEARTBEAT 1 // Send the cached fix with its age
+#define STILL_SKIP 2	  // Skip the uplink
+
+/** Longest time in seconds a cached fix is reused */
+#define STILL_MAX_CACHE_TIME 86400
+
+/** Maximum number of data rates in a survey burst */
+#define SURVEY_MAX_DR 8
+
+/** Application settings, saved in flash */
+struct mapper_settings_s
 {
-	uint32_t val32;
-	uint8_t val8[4];
+	uint8_t valid_mark_1 = 0xAA;
+	uint8_t valid_mark_2 = 0x55;
+	uint8_t still_mode = STILL_POLL;	  // Stationary handling, heartbeats on fport 5 are opt-in
+	uint32_t fix_cache_time = 3600;		  // Seconds a cached fix is reused while not moving
+	uint16_t acc_false_wakes = 4;		  // Allowed wakeups per hour without movement
+	uint16_t cover_every = 4;			  // Send every Nth fix in covered cells, 0 = send all
+	uint8_t survey_enable = 0;			  // Send a multi data rate burst in every new cell
+	uint8_t survey_dr_count = 4;		  // Number of data rates in survey_drs
+	uint8_t survey_drs[SURVEY_MAX_DR] = {0, 1, 2, 3}; // Data rates of a survey burst
+	uint16_t survey_gap = 0;						  // Minimum seconds between burst uplinks
+	uint8_t link_adapt = 0;							  // Adapt DR, confirmed uplinks and interval to the link quality, opt-in
+	uint8_t batt_policy = 1;						  // Stretch send interval and fix reuse time as the battery drains
+	uint8_t trigger_mode = 0;						  // Send on distance or heading change while moving
+	uint16_t trigger_dist = 250;					  // Distance in meters that triggers an uplink
+	uint8_t trigger_heading = 30;					  // Heading change in degrees that triggers an uplink
+	uint8_t trigger_poll = 10;						  // Seconds between GNSS polls while moving
+	uint8_t trigger_max_hour = 60;					  // Maximum triggered uplinks per hour
+	uint8_t gnss_profile = GNSS_PROFILE_AUTO;		  // GNSS configuration profile
 };
+extern mapper_settings_s g_mapper_settings;
+void init_mapper_settings(void);
+bool save_mapper_settings(void);
+
+// Coverage aware sampling
+#include "coverage_filter.h"
+extern coverage_filter<COVERAGE_FILTER_BYTES> g_coverage;
+void init_coverage(void);
+bool coverage_downlink(uint8_t *data, uint16_t len);
+bool coverage_should_send(gnss_fix_s &fix);
+
+// Privacy/exclusion zones
+#include "zone_index.h"
+extern zone_index g_zones;
+void init_zones(void);
+bool save_zones(void);
+bool zones_apply(gnss_fix_s &fix);
+
+// Multi data rate survey
+#define SURVEY_FPORT MAPPER_FPORT_SURVEY
+#define SURVEY_CMD_STOP 0x00  // [0x00] disable survey mode
+#define SURVEY_CMD_START 0x01 // [0x01][dr ...] enable survey mode, optional new data rate list
+void init_survey(void);
+bool survey_start(gnss_fix_s &fix);
+bool survey_active(void);
+void survey_next(void);
+void survey_tx_finished(void);
+bool survey_downlink(uint8_t *data, uint16_t len);
+
+// Link quality feedback
+void link_reset(void);
+bool link_before_tx(uint8_t len);
+bool link_tx_confirmed(void);
+uint8_t link_data_rate(void);
+void link_rx(int16_t rssi, int8_t snr, uint8_t len);
+void link_tx_finished(bool acked);
+int16_t link_margin_q4(void);
+int16_t link_rssi(void);
+uint8_t link_ack_percent(void);
+uint8_t link_interval_factor(void);
+
+// Distance and heading trigger
+void init_trigger(void);
+void trigger_restart(void);
+void trigger_anchor(gnss_fix_s &fix);
+bool trigger_take_fix(gnss_fix_s &fix);
+bool trigger_fired(void);
+void trigger_track(void);
+
+// Battery model
+extern uint16_t batt_level;
+uint16_t batt_update(uint16_t mv);
+void batt_uplink(void);
+uint16_t batt_soc_pm(void);
+int32_t batt_runtime_min(void);
+uint8_t batt_interval_factor(void);
+
+// RAM headroom
+void mem_sample(void);
+uint32_t mem_heap_free(void);
+uint32_t mem_heap_min_free(void);
+uint32_t mem_stack_free(void);
+void mem_print_tasks(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,228 @@
+/**
+ * @file battery.cpp
+ * @author agent (agent@local)
+ * @brief Battery model. Filters the battery voltage, estimates the state
+ *        of charge from a LiPo discharge curve and the remaining runtime
+ *        from the charge used per uplink. A policy curve stretches the send
+ *        interval and the reuse time of a cached fix as the charge drops.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Point of the discharge curve */
+struct batt_curve_s
+{
+	uint16_t mv;
+	uint16_t soc_pm; // State of charge in 0.1%
+};
+
+/** Open circuit discharge curve of a LiPo cell, sorted by falling voltage */
+static const batt_curve_s batt_curve[] = {
+	{4200, 1000},
+	{4150, 950},
+	{4110, 900},
+	{4080, 850},
+	{4020, 800},
+	{3980, 750},
+	{3950, 700},
+	{3910, 650},
+	{3870, 600},
+	{3850, 550},
+	{3840, 500},
+	{3820, 450},
+	{3800, 400},
+	{3790, 350},
+	{3770, 300},
+	{3750, 250},
+	{3730, 200},
+	{3710, 150},
+	{3690, 100},
+	{3610, 50},
+	{3270, 0},
+};
+
+/** Point of the policy curve */
+struct batt_policy_s
+{
+	uint16_t soc_pm; // Lowest state of charge of this step in 0.1%
+	uint8_t factor;	 // Factor for send interval, fix reuse time and GNSS measurement period
+};
+
+/** Policy curve, sorted by falling state of charge */
+static const batt_policy_s batt_policy[] = {
+	{500, 1},
+	{300, 2},
+	{150, 4},
+	{50, 8},
+	{0, 16},
+};
+
+/** Smallest drop of the state of charge in 0.1% used to measure the cost per uplink */
+#define BATT_COST_MIN_DROP 10
+
+/** Rise of the state of charge in 0.1% that counts as charged, smaller rises are noise */
+#define BATT_CHARGE_MIN_RISE 10
+
+/** Filtered voltage in 1/16 mV */
+static uint32_t batt_q4 = 0;
+
+/** State of charge in 0.1% */
+static uint16_t soc_pm = 1000;
+
+/** Charge used per 100 uplinks in 0.1%, 0 = not known yet */
+static uint16_t cost_pm = 0;
+
+/** State of charge at the start of the cost measurement */
+static uint16_t cost_start_pm = 0;
+
+/** Uplinks since the start of the cost measurement */
+static uint16_t cost_uplinks = 0;
+
+/** Current policy factor */
+static uint8_t batt_factor = 1;
+
+/**
+ * @brief State of charge from the discharge curve, linear interpolation
+ *
+ * @param mv battery voltage
+ * @return uint16_t state of charge in 0.1%
+ */
+static uint16_t batt_soc(uint16_t mv)
+{
+	if (mv >= batt_curve[0].mv)
+	{
+		return batt_curve[0].soc_pm;
+	}
+	for (uint8_t idx = 1; idx < sizeof(batt_curve) / sizeof(batt_curve_s); idx++)
+	{
+		const batt_curve_s &upper = batt_curve[idx - 1];
+		const batt_curve_s &lower = batt_curve[idx];
+		if (mv >= lower.mv)
+		{
+			return lower.soc_pm + (uint32_t)(mv - lower.mv) * (upper.soc_pm - lower.soc_pm) / (upper.mv - lower.mv);
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Add a battery reading. Called once per STATUS event.
+ *
+ * @param mv measured battery voltage
+ * @return uint16_t filtered battery voltage
+ */
+uint16_t batt_update(uint16_t mv)
+{
+	// EMA with alpha 1/8, the first reading starts the filter
+	if (batt_q4 == 0)
+	{
+		batt_q4 = (uint32_t)mv << 4;
+	}
+	else
+	{
+		batt_q4 = batt_q4 - batt_q4 / 8 + ((uint32_t)mv << 4) / 8;
+	}
+	uint16_t filtered = (uint16_t)((batt_q4 + 8) >> 4);
+	soc_pm = batt_soc(filtered);
+
+	// A rising charge means the battery is charged, restart the cost measurement
+	if ((cost_uplinks == 0) || (soc_pm > cost_start_pm + BATT_CHARGE_MIN_RISE))
+	{
+		cost_start_pm = soc_pm;
+		cost_uplinks = 0;
+	}
+	else if ((cost_start_pm - soc_pm >= BATT_COST_MIN_DROP) && (cost_uplinks != 0))
+	{
+		uint16_t cost = (uint32_t)(cost_start_pm - soc_pm) * 100 / cost_uplinks;
+		cost = cost == 0 ? 1 : cost;
+		cost_pm = cost_pm == 0 ? cost : (cost_pm * 3 + cost) / 4;
+		cost_start_pm = soc_pm;
+		cost_uplinks = 0;
+	}
+
+	if (g_mapper_settings.batt_policy)
+	{
+		uint8_t factor = batt_factor;
+		for (uint8_t idx = 0; idx < sizeof(batt_policy) / sizeof(batt_policy_s); idx++)
+		{
+			// 2% hysteresis before a step back to a shorter interval
+			uint16_t limit = batt_policy[idx].factor < batt_factor ? batt_policy[idx].soc_pm + 20 : batt_policy[idx].soc_pm;
+			if (soc_pm >= limit)
+			{
+				factor = batt_policy[idx].factor;
+				break;
+			}
+		}
+		if (factor != batt_factor)
+		{
+			batt_factor = factor;
+			AT_PRINTF("+EVT:BATT FACTOR %d", batt_factor);
+			if (g_lorawan_settings.send_repeat_time != 0)
+			{
+				api_timer_restart(send_interval());
+			}
+		}
+	}
+	else if (batt_factor != 1)
+	{
+		batt_factor = 1;
+		if (g_lorawan_settings.send_repeat_time != 0)
+		{
+			api_timer_restart(send_interval());
+		}
+	}
+
+	MYLOG("BATT", "%d mV filtered %d mV, %d.%d%%", mv, filtered, soc_pm / 10, soc_pm % 10);
+	return filtered;
+}
+
+/**
+ * @brief Count an uplink for the cost measurement
+ *
+ */
+void batt_uplink(void)
+{
+	if (cost_uplinks < UINT16_MAX)
+	{
+		cost_uplinks++;
+	}
+}
+
+/**
+ * @brief State of charge
+ *
+ * @return uint16_t state of charge in 0.1%
+ */
+uint16_t batt_soc_pm(void)
+{
+	return soc_pm;
+}
+
+/**
+ * @brief Remaining runtime at the current send interval
+ *
+ * @return int32_t runtime in minutes, -1 if the cost per uplink is not known yet
+ */
+int32_t batt_runtime_min(void)
+{
+	if ((cost_pm == 0) || (g_lorawan_settings.send_repeat_time == 0))
+	{
+		return -1;
+	}
+	uint32_t uplinks = (uint32_t)soc_pm * 100 / cost_pm;
+	return (int32_t)((uint64_t)uplinks * send_interval() / 60000);
+}
+
+/**
+ * @brief Current policy factor
+ *
+ * @return uint8_t factor for send interval, fix reuse time and GNSS measurement period
+ */
+uint8_t batt_interval_factor(void)
+{
+	return batt_factor;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file coverage.cpp
+ * @author agent (agent@local)
+ * @brief Coverage aware sampling. The network server sends a Bloom
+ *        filter of already covered cells, fixes inside these cells
+ *        are sent less often.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Filter of covered cells */
+coverage_filter<COVERAGE_FILTER_BYTES> g_coverage;
+
+/** Name of the filter file */
+static const char coverage_name[] = "COVER";
+
+/** File to save the filter */
+static File coverage_file(InternalFS);
+
+/** Fixes in covered cells since the last one that was sent */
+static uint16_t covered_skipped = 0;
+
+/**
+ * @brief Read the coverage filter from flash, starts empty if there is none
+ *
+ */
+void init_coverage(void)
+{
+	g_coverage.clear();
+	if (coverage_file.open(coverage_name, FILE_O_READ))
+	{
+		if (coverage_file.size() == sizeof(g_coverage.data))
+		{
+			coverage_file.read(g_coverage.data, sizeof(g_coverage.data));
+			MYLOG("COV", "Coverage filter loaded");
+		}
+		coverage_file.close();
+	}
+}
+
+/**
+ * @brief Save the coverage filter to flash
+ *
+ */
+static void save_coverage(void)
+{
+	InternalFS.remove(coverage_name);
+	if (coverage_file.open(coverage_name, FILE_O_WRITE))
+	{
+		coverage_file.write(g_coverage.data, sizeof(g_coverage.data));
+		coverage_file.close();
+		MYLOG("COV", "Coverage filter saved");
+	}
+}
+
+/**
+ * @brief Handle a coverage filter downlink on COVERAGE_FPORT.
+ *        A filter update can span many downlinks, it is saved
+ *        to flash only with COVERAGE_CMD_SAVE.
+ *
+ * @param data downlink payload
+ * @param len payload length
+ * @return true valid command
+ * @return false unknown command or wrong length
+ */
+bool coverage_downlink(uint8_t *data, uint16_t len)
+{
+	if (len == 0)
+	{
+		return false;
+	}
+
+	switch (data[0])
+	{
+	case COVERAGE_CMD_CLEAR:
+		g_coverage.clear();
+		covered_skipped = 0;
+		AT_PRINTF("+EVT:COVERAGE CLEAR");
+		return true;
+
+	case COVERAGE_CMD_CHUNK:
+	{
+		if (len < 4)
+		{
+			return false;
+		}
+		uint16_t offset = ((uint16_t)data[1] << 8) | data[2];
+		uint16_t chunk_len = len - 3;
+		if ((uint32_t)offset + chunk_len > sizeof(g_coverage.data))
+		{
+			return false;
+		}
+		memcpy(&g_coverage.data[offset], &data[3], chunk_len);
+		MYLOG("COV", "Filter chunk %d bytes at %d", chunk_len, offset);
+		return true;
+	}
+
+	case COVERAGE_CMD_CELLS:
+		if ((len - 1) % 8 != 0)
+		{
+			return false;
+		}
+		for (uint16_t pos = 1; pos < len; pos += 8)
+		{
+			coverage_cell_s cell;
+			cell.lat_q = (int32_t)(((uint32_t)data[pos] << 24) | ((uint32_t)data[pos + 1] << 16) | ((uint32_t)data[pos + 2] << 8) | data[pos + 3]);
+			cell.lon_q = (int32_t)(((uint32_t)data[pos + 4] << 24) | ((uint32_t)data[pos + 5] << 16) | ((uint32_t)data[pos + 6] << 8) | data[pos + 7]);
+			g_coverage.add(cell);
+		}
+		MYLOG("COV", "Added %d cells", (len - 1) / 8);
+		return true;
+
+	case COVERAGE_CMD_SAVE:
+		save_coverage();
+		AT_PRINTF("+EVT:COVERAGE UPDATED");
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Check if a fix should be sent. Fixes in covered cells
+ *        are only sent every g_mapper_settings.cover_every time.
+ *
+ * @param fix new position
+ * @return true send the fix
+ * @return false cell is covered, skip the uplink
+ */
+bool coverage_should_send(gnss_fix_s &fix)
+{
+	if (g_mapper_settings.cover_every == 0)
+	{
+		return true;
+	}
+
+	if (!g_coverage.contains(coverage_cell(fix.lat_e7, fix.lon_e7)))
+	{
+		covered_skipped = 0;
+		return true;
+	}
+
+	covered_skipped++;
+	if (covered_skipped >= g_mapper_settings.cover_every)
+	{
+		covered_skipped = 0;
+		return true;
+	}
+	MYLOG("COV", "Cell is covered, skip %d of %d", covered_skipped, g_mapper_settings.cover_every);
+	return false;
+}
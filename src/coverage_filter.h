@@ -0,0 +1,123 @@
+/**
+ * @file coverage_filter.h
+ * @author agent (agent@local)
+ * @brief Bloom filter of map cells that already have coverage.
+ *        The network server side tool in tools/coverage_filter
+ *        builds the filter with the same code.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef COVERAGE_FILTER_H
+#define COVERAGE_FILTER_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** Cell size of the coverage grid in 1e-7 degrees, 0.003 degrees is about 330 m */
+#define COVERAGE_GRID_E7 30000
+
+/** Filter size used by the device, 3000 cells give about 1% false positives */
+#define COVERAGE_FILTER_BYTES 4096
+
+/** Number of hash functions */
+#define COVERAGE_HASHES 4
+
+/** Cell of the coverage grid */
+struct coverage_cell_s
+{
+	int32_t lat_q;
+	int32_t lon_q;
+};
+
+/**
+ * @brief Grid cell of a position, rounds towards negative infinity
+ *
+ * @param lat_e7 latitude in 1e-7 degrees
+ * @param lon_e7 longitude in 1e-7 degrees
+ * @return coverage_cell_s cell
+ */
+static inline coverage_cell_s coverage_cell(int32_t lat_e7, int32_t lon_e7)
+{
+	coverage_cell_s cell;
+	cell.lat_q = lat_e7 >= 0 ? lat_e7 / COVERAGE_GRID_E7 : -((-lat_e7 + COVERAGE_GRID_E7 - 1) / COVERAGE_GRID_E7);
+	cell.lon_q = lon_e7 >= 0 ? lon_e7 / COVERAGE_GRID_E7 : -((-lon_e7 + COVERAGE_GRID_E7 - 1) / COVERAGE_GRID_E7);
+	return cell;
+}
+
+/**
+ * @brief 32 bit finalizer of MurmurHash3
+ */
+static inline uint32_t coverage_mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/**
+ * @brief Bloom filter over grid cells. Bit i of the filter is
+ *        bit (i & 7) of byte (i >> 3). The k bit positions of a cell are
+ *        h1 + i * h2 modulo the number of bits (double hashing).
+ *
+ * @tparam Bytes filter size in bytes
+ */
+template <uint16_t Bytes>
+struct coverage_filter
+{
+	static constexpr uint32_t bits = (uint32_t)Bytes * 8;
+
+	uint8_t data[Bytes];
+
+	void clear(void)
+	{
+		memset(data, 0, sizeof(data));
+	}
+
+	static inline void hashes(const coverage_cell_s &cell, uint32_t &h1, uint32_t &h2)
+	{
+		h1 = coverage_mix((uint32_t)cell.lat_q * 0x9E3779B1 ^ (uint32_t)cell.lon_q);
+		h2 = coverage_mix(h1 ^ 0x5BD1E995) | 1;
+	}
+
+	void add(const coverage_cell_s &cell)
+	{
+		uint32_t h1, h2;
+		hashes(cell, h1, h2);
+		for (uint8_t idx = 0; idx < COVERAGE_HASHES; idx++)
+		{
+			uint32_t bit = (h1 + idx * h2) % bits;
+			data[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+		}
+	}
+
+	bool contains(const coverage_cell_s &cell) const
+	{
+		uint32_t h1, h2;
+		hashes(cell, h1, h2);
+		for (uint8_t idx = 0; idx < COVERAGE_HASHES; idx++)
+		{
+			uint32_t bit = (h1 + idx * h2) % bits;
+			if ((data[bit >> 3] & (1 << (bit & 7))) == 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/** Downlink port and commands for the coverage filter */
+#define COVERAGE_FPORT 6
+#define COVERAGE_CMD_CLEAR 0x01 // [0x01] clear the filter
+#define COVERAGE_CMD_CHUNK 0x02 // [0x02][offset MSB][offset LSB][filter bytes ...] write filter bytes
+#define COVERAGE_CMD_CELLS 0x03 // [0x03][lat_q 4 bytes MSB first][lon_q 4 bytes MSB first]... add cells
+#define COVERAGE_CMD_SAVE 0x04	// [0x04] update finished, save the filter to flash
+
+#endif
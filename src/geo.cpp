@@ -0,0 +1,130 @@
+/**
+ * @file geo.cpp
+ * @author agent (agent@local)
+ * @brief Cosine and arc tangent tables and the fixed point
+ *        distance and bearing between two fixes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "geo.h"
+
+/** Cosine * 32768 for 0 to 90 degrees in 1 degree steps */
+static const uint16_t geo_cos_table[91] = {
+	32768, 32763, 32748, 32723, 32688, 32643, 32588, 32524, 32449, 32365,
+	32270, 32166, 32052, 31928, 31795, 31651, 31499, 31336, 31164, 30983,
+	30792, 30592, 30382, 30163, 29935, 29698, 29452, 29197, 28932, 28660,
+	28378, 28088, 27789, 27482, 27166, 26842, 26510, 26170, 25822, 25466,
+	25102, 24730, 24351, 23965, 23571, 23170, 22763, 22348, 21926, 21498,
+	21063, 20622, 20174, 19720, 19261, 18795, 18324, 17847, 17364, 16877,
+	16384, 15886, 15384, 14876, 14365, 13848, 13328, 12803, 12275, 11743,
+	11207, 10668, 10126, 9580, 9032, 8481, 7927, 7371, 6813, 6252,
+	5690, 5126, 4560, 3993, 3425, 2856, 2286, 1715, 1144, 572,
+	0};
+
+/** Arc tangent in 0.01 degrees for 0 to 1 in steps of 1/32 */
+static const uint16_t geo_atan_table[33] = {
+	0, 179, 358, 536, 713, 888, 1062, 1234, 1404, 1571,
+	1735, 1897, 2056, 2211, 2363, 2511, 2657, 2798, 2936, 3070,
+	3201, 3327, 3451, 3571, 3687, 3800, 3909, 4016, 4119, 4218,
+	4315, 4409, 4500};
+
+/**
+ * @brief Cosine of a latitude, linear interpolation between the table entries
+ */
+uint16_t geo_cos_q15(int32_t lat_e7)
+{
+	uint32_t lat = lat_e7 < 0 ? (uint32_t)(-(int64_t)lat_e7) : (uint32_t)lat_e7;
+	if (lat >= 900000000)
+	{
+		return 0;
+	}
+	uint32_t idx = lat / 10000000;
+	uint32_t frac = lat % 10000000;
+	int32_t diff = (int32_t)geo_cos_table[idx + 1] - geo_cos_table[idx];
+	return (uint16_t)(geo_cos_table[idx] + (int64_t)diff * frac / 10000000);
+}
+
+/**
+ * @brief Arc tangent, reduced to the first octant and interpolated in the table
+ */
+uint16_t geo_atan2_cdeg(int64_t east, int64_t north)
+{
+	uint64_t x = east < 0 ? -east : east;
+	uint64_t y = north < 0 ? -north : north;
+	if ((x == 0) && (y == 0))
+	{
+		return 0;
+	}
+
+	// Angle from north towards east in the first quadrant
+	bool swap = x > y;
+	uint64_t num = swap ? y : x;
+	uint64_t den = swap ? x : y;
+	// Ratio in 1/65536, scaled down first to keep the product in 64 bit
+	while (num > 0xFFFFFFFFFFFull)
+	{
+		num >>= 1;
+		den >>= 1;
+	}
+	uint32_t ratio = (uint32_t)((num << 16) / den);
+	uint32_t idx = ratio >> 11;
+	uint32_t frac = ratio & 0x7FF;
+	uint32_t angle = geo_atan_table[idx];
+	if (idx < 32)
+	{
+		angle += ((geo_atan_table[idx + 1] - geo_atan_table[idx]) * frac + 1024) >> 11;
+	}
+	angle = swap ? 9000 - angle : angle;
+
+	if (north < 0)
+	{
+		angle = 18000 - angle;
+	}
+	if (east < 0)
+	{
+		angle = (36000 - angle) % 36000;
+	}
+	return (uint16_t)angle;
+}
+
+/**
+ * @brief Distance and bearing, equirectangular approximation at the mean latitude
+ */
+void geo_delta(int32_t lat1_e7, int32_t lon1_e7, int32_t lat2_e7, int32_t lon2_e7, uint32_t &dist_mm, uint16_t &bearing_cdeg)
+{
+	int64_t dlat = (int64_t)lat2_e7 - lat1_e7;
+	int64_t dlon = (int64_t)lon2_e7 - lon1_e7;
+	// Shortest way across the date line
+	if (dlon > 1800000000)
+	{
+		dlon -= 3600000000LL;
+	}
+	else if (dlon < -1800000000)
+	{
+		dlon += 3600000000LL;
+	}
+	int64_t east = (dlon * geo_cos_q15((int32_t)(((int64_t)lat1_e7 + lat2_e7) / 2))) >> 15;
+
+	bearing_cdeg = geo_atan2_cdeg(east, dlat);
+
+	// Integer square root of the distance in 1e-7 degrees
+	uint64_t square = (uint64_t)(east * east) + (uint64_t)(dlat * dlat);
+	uint64_t root = 0;
+	for (uint64_t bit = (uint64_t)1 << 62; bit != 0; bit >>= 2)
+	{
+		if (square >= root + bit)
+		{
+			square -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+	}
+	uint64_t mm = root * GEO_M_PER_DEG / 10000;
+	dist_mm = mm > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)mm;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file geo.h
+ * @author agent (agent@local)
+ * @brief Fixed point geodesy for consecutive fixes. Equirectangular
+ *        approximation with table based cosine and arc tangent.
+ *        tools/geo checks the results against haversine.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef GEO_H
+#define GEO_H
+
+#include <stdint.h>
+
+/** Meters per degree of latitude, mean earth radius 6371 km */
+#define GEO_M_PER_DEG 111195
+
+/**
+ * @brief Cosine of a latitude
+ *
+ * @param lat_e7 latitude in 1e-7 degrees
+ * @return uint16_t cosine * 32768
+ */
+uint16_t geo_cos_q15(int32_t lat_e7);
+
+/**
+ * @brief Arc tangent of east / north
+ *
+ * @param east east component
+ * @param north north component
+ * @return uint16_t bearing in 0.01 degrees, 0 = north, 9000 = east
+ */
+uint16_t geo_atan2_cdeg(int64_t east, int64_t north);
+
+/**
+ * @brief Distance and bearing between two positions
+ *
+ * @param lat1_e7 start latitude in 1e-7 degrees
+ * @param lon1_e7 start longitude in 1e-7 degrees
+ * @param lat2_e7 end latitude in 1e-7 degrees
+ * @param lon2_e7 end longitude in 1e-7 degrees
+ * @param dist_mm distance in mm, saturates at UINT32_MAX
+ * @param bearing_cdeg bearing from start to end in 0.01 degrees
+ */
+void geo_delta(int32_t lat1_e7, int32_t lon1_e7, int32_t lat2_e7, int32_t lon2_e7, uint32_t &dist_mm, uint16_t &bearing_cdeg);
+
+/**
+ * @brief Absolute difference of two bearings
+ *
+ * @param from bearing in 0.01 degrees
+ * @param to bearing in 0.01 degrees
+ * @return uint16_t difference in 0.01 degrees, 0 to 18000
+ */
+static inline uint16_t geo_bearing_diff(uint16_t from, uint16_t to)
+{
+	uint16_t diff = from > to ? from - to : to - from;
+	return diff > 18000 ? 36000 - diff : diff;
+}
+
+#endif
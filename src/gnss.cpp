@@ -14,23 +14,82 @@
  * 
  */
 #include "app.h"
+#include "gnss_backend.h"
+#include <new>
 
-// The GNSS object
-TinyGPSPlus my_rak1910_gnss;	 // RAK1910_GNSS
-SFE_UBLOX_GNSS my_rak12500_gnss; // RAK12500_GNSS
+/** Static arena, holds only the detected GNSS backend */
+static uint8_t gnss_arena[GNSS_ARENA_SIZE] __attribute__((aligned(GNSS_ARENA_ALIGN)));
 
-/** GNSS polling function */
-bool poll_gnss(void);
-
-/** Location data as byte array */
-mapper_data_s g_mapper_data;
-
-/** Latitude/Longitude value converter */
-latLong_s pos_union;
+/** Last valid location of a STATUS event, the distance trigger keeps its own */
+gnss_fix_s g_last_fix;
 
 /** Flag if location was found */
 bool last_read_ok = false;
 
+/**
+ * @brief Access the backend living in the arena
+ *
+ * @tparam T backend class
+ * @return T* pointer to the backend
+ */
+template <class T>
+static inline T *gnss_backend(void)
+{
+	return reinterpret_cast<T *>(gnss_arena);
+}
+
+/**
+ * @brief Construct a backend in the arena and start it.
+ *        The backend is destroyed again if it fails to start.
+ *
+ * @tparam T backend class
+ * @return true backend started
+ * @return false backend not found, arena is free again
+ */
+template <class T>
+static bool gnss_construct(void)
+{
+	T *backend = new (gnss_arena) T();
+	if (backend->begin())
+	{
+		return true;
+	}
+	backend->~T();
+	return false;
+}
+
+/** Shortest RAK1910 poll window in ms */
+#define GNSS_POLL_MS 10000
+
+/**
+ * @brief Check if two profiles write the same values to the module
+ */
+static inline bool gnss_profile_equal(const gnss_profile_s &a, const gnss_profile_s &b)
+{
+	return (a.dyn_model == b.dyn_model) && (a.meas_ms == b.meas_ms) && (a.nav_rate == b.nav_rate) && (a.systems == b.systems);
+}
+
+/**
+ * @brief Write the profile selected by the scheduler to the active backend
+ *
+ * @param gnss_option active backend
+ */
+static void gnss_apply_profile(uint8_t gnss_option)
+{
+	switch (gnss_option)
+	{
+	case RAK1910_GNSS:
+		gnss_backend<gnss_rak1910>()->apply(gnss_profile());
+		break;
+	case RAK12500_GNSS:
+		gnss_backend<gnss_rak12500>()->apply(gnss_profile());
+		break;
+	case REPLAY_GNSS:
+		gnss_backend<gnss_replay>()->apply(gnss_profile());
+		break;
+	}
+}
+
 /**
  * @brief Detect and initialize a connected GNSS module. Supports RAK12500 and RAK1910.
  * 
@@ -49,128 +108,354 @@ uint8_t init_gnss(void)
 	// Give the module some time to power up
 	delay(500);
 
+#if GNSS_REPLAY > 0
+	gnss_construct<gnss_replay>();
+	MYLOG("GNSS", "Using GNSS replay backend");
+	gnss_apply_profile(REPLAY_GNSS);
+	return REPLAY_GNSS;
+#else
 	// Initialize RAK12500 if present, otherwise initialize RAK1910
-	Wire.begin();
-	bool rak12500_present = my_rak12500_gnss.begin();
-
 	MYLOG("GNSS", "Trying to initialize RAK12500");
 
-	if (rak12500_present)
+	if (gnss_construct<gnss_rak12500>())
 	{
-		my_rak12500_gnss.setI2COutput(COM_TYPE_UBX);				 // Set the I2C port to output UBX only (turn off NMEA noise)
-		my_rak12500_gnss.saveConfigSelective(VAL_CFG_SUBSEC_IOPORT); // Save (only) the communications port settings to flash and BBR
 		MYLOG("GNSS", "Detected and initialized RAK12500");
+		gnss_apply_profile(RAK12500_GNSS);
 		return RAK12500_GNSS;
 	}
-	else
+
+	MYLOG("GNSS", "RAK12500 not detected at default I2C address");
+	MYLOG("GNSS", "Trying to initialize RAK1910");
+	gnss_construct<gnss_rak1910>();
+	MYLOG("GNSS", "Initialized RAK1910");
+	gnss_apply_profile(RAK1910_GNSS);
+	return RAK1910_GNSS;
+#endif
+}
+
+/**
+ * @brief Start the RAK12500 on I2C
+ *
+ * @return true module answered
+ * @return false module not found
+ */
+bool gnss_rak12500::begin(void)
+{
+	Wire.begin();
+	if (!ublox.begin())
 	{
-		MYLOG("GNSS", "RAK12500 not detected at default I2C address");
 		Wire.end();
-
-		MYLOG("GNSS", "Trying to initialize RAK1910");
-		Serial1.begin(9600);
-		while (!Serial1)
-			;
-		MYLOG("GNSS", "Initialized RAK1910");
-		return RAK1910_GNSS;
+		return false;
 	}
+	ublox.setI2COutput(COM_TYPE_UBX);				  // Set the I2C port to output UBX only (turn off NMEA noise)
+	ublox.saveConfigSelective(VAL_CFG_SUBSEC_IOPORT); // Save (only) the communications port settings to flash and BBR
+	return true;
 }
 
 /**
- * @brief Check GNSS module for position
- * 
- * @return Is valid position found (bool)
+ * @brief Read the current navigation solution of the RAK12500
+ *
+ * @param fix filled with the position if available
+ * @return true valid position
+ * @return false no fix
  */
-bool poll_gnss(uint8_t gnss_option)
+bool gnss_rak12500::poll(gnss_fix_s &fix)
 {
-	time_t time_out = millis();
-	bool has_pos = false;
-	int64_t latitude = 0;
-	int64_t longitude = 0;
-	int32_t altitude = 0;
-	int32_t accuracy = 0;
-	uint32_t polling_seconds;
-	uint32_t polling_miliseconds;
+	MYLOG("GNSS", "Polling RAK12500");
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.print("Polling RAK12500\n");
+	}
 
-	bool has_alt = false;
+	if (!ublox.getGnssFixOk())
+	{
+		return false;
+	}
+	fix.lat_e7 = ublox.getLatitude();
+	fix.lon_e7 = ublox.getLongitude();
+	fix.alt_mm = ublox.getAltitude();
+	fix.hdop_e2 = ublox.getHorizontalDOP();
+	fix.sats = ublox.getSIV();
+	return true;
+}
 
-	digitalWrite(LED_BUILTIN, HIGH);
+/**
+ * @brief Write a profile to the RAK12500 with UBX-CFG-GNSS/NAV5/RATE.
+ *        Only the values that differ from the active profile are written,
+ *        a constellation change restarts the receiver. Constellations
+ *        change only when the profile setting is changed. The profile is kept
+ *        in RAM of the module, switching it does not wear its flash.
+ *
+ * @param profile profile to write
+ * @return true profile active
+ * @return false module did not accept a value, everything is written again next time
+ */
+bool gnss_rak12500::apply(const gnss_profile_s &profile)
+{
+	if (applied_valid && gnss_profile_equal(applied, profile))
+	{
+		return true;
+	}
 
-	// Poll the GPS according to the initialized module
-	switch (gnss_option)
+	bool all = !applied_valid;
+	bool ok = true;
+	// GPS, SBAS, Galileo, BeiDou, QZSS and GLONASS, IMES is left alone
+	uint8_t changed = (all ? 0xFF : (applied.systems ^ profile.systems)) & 0x6F;
+	for (uint8_t id = 0; id < 8; id++)
 	{
-	case RAK1910_GNSS:
-		MYLOG("GNSS", "Polling RAK1910");
-		if (g_ble_uart_is_connected)
+		if (changed & (1 << id))
 		{
-			g_ble_uart.print("Polling RAK1910\n");
+			ok &= ublox.enableGNSS((profile.systems & (1 << id)) != 0, (sfe_ublox_gnss_ids_e)id);
 		}
+	}
+	if (all || (applied.dyn_model != profile.dyn_model))
+	{
+		ok &= ublox.setDynamicModel((dynModel)profile.dyn_model);
+	}
+	if (all || (applied.meas_ms != profile.meas_ms))
+	{
+		ok &= ublox.setMeasurementRate(profile.meas_ms);
+	}
+	if (all || (applied.nav_rate != profile.nav_rate))
+	{
+		ok &= ublox.setNavigationRate(profile.nav_rate);
+	}
 
-		while ((millis() - time_out) < 10000)
-		{
-			polling_miliseconds = millis() - time_out;
+	applied = profile;
+	applied_valid = ok;
+	MYLOG("GNSS", "RAK12500 %s profile %s", profile.name, ok ? "set" : "failed");
+	return ok;
+}
+
+/**
+ * @brief Start the RAK1910 on Serial1
+ *
+ * @return true always, the module cannot be detected on UART
+ */
+bool gnss_rak1910::begin(void)
+{
+	Serial1.begin(9600);
+	while (!Serial1)
+		;
+	return true;
+}
+
+/**
+ * @brief Parse NMEA data from the RAK1910 until a GGA sentence
+ *        with a valid fix is found or the poll window has passed.
+ *        The window is 10 seconds or two measurement periods if the
+ *        battery policy stretched them.
+ *
+ * @param fix filled with the position if available
+ * @return true valid position
+ * @return false no fix
+ */
+bool gnss_rak1910::poll(gnss_fix_s &fix)
+{
+	time_t time_out = millis();
+	uint32_t window_ms = applied_valid && (2 * (uint32_t)applied.meas_ms > GNSS_POLL_MS) ? 2 * (uint32_t)applied.meas_ms : GNSS_POLL_MS;
+	uint32_t polling_seconds = 0;
+	uint32_t polling_miliseconds;
+	bool has_pos = false;
+
+	MYLOG("GNSS", "Polling RAK1910");
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.print("Polling RAK1910\n");
+	}
+
+	while ((millis() - time_out) < window_ms)
+	{
+		polling_miliseconds = millis() - time_out;
 
-			if ( (polling_miliseconds % 1000 == 0) && (polling_miliseconds / 1000 != polling_seconds)) 
+		if ((polling_miliseconds % 1000 == 0) && (polling_miliseconds / 1000 != polling_seconds))
+		{
+			polling_seconds = polling_miliseconds / 1000;
+			MYLOG("GNSS", "Polling elapsed time: %d s", polling_seconds);
+			if (g_ble_uart_is_connected)
 			{
-				polling_seconds = polling_miliseconds / 1000;
-				MYLOG("GNSS", "Polling elapsed time: %d s", polling_seconds);
-				if (g_ble_uart_is_connected)
-				{
-					g_ble_uart.printf("Polling elapsed time: %d s", polling_seconds);
-				}
-			} 
+				g_ble_uart.printf("Polling elapsed time: %d s", polling_seconds);
+			}
+		}
 
-			while (Serial1.available() > 0)
+		while (Serial1.available() > 0)
+		{
+			// Only GGA carries position, altitude, HDOP and satellites in one sentence
+			if (parser.encode(Serial1.read()) == NMEA_GGA)
 			{
-				// if (my_rak1910_gnss.encode(ss.read()))
-				if (my_rak1910_gnss.encode(Serial1.read()))
-				{
-					digitalToggle(LED_BUILTIN);
-					if (my_rak1910_gnss.location.isUpdated() && my_rak1910_gnss.location.isValid())
-					{
-						has_pos = true;
-						latitude = my_rak1910_gnss.location.lat() * 100000;
-						longitude = my_rak1910_gnss.location.lng() * 100000;
-					}
-					else if (my_rak1910_gnss.altitude.isUpdated() && my_rak1910_gnss.altitude.isValid())
-					{
-						has_alt = true;
-						altitude = my_rak1910_gnss.altitude.meters();
-					}
-					else if (my_rak1910_gnss.hdop.isUpdated() && my_rak1910_gnss.hdop.isValid())
-					{
-						accuracy = my_rak1910_gnss.hdop.hdop() * 100;
-					}
-				}
-				if (has_pos && has_alt)
+				digitalToggle(LED_BUILTIN);
+				if (parser.data.quality != 0)
 				{
+					has_pos = true;
+					fix.lat_e7 = parser.data.lat_e7;
+					fix.lon_e7 = parser.data.lon_e7;
+					fix.alt_mm = parser.data.alt_mm;
+					fix.hdop_e2 = parser.data.hdop_e2;
+					fix.sats = parser.data.sats;
 					break;
 				}
 			}
-			if (has_pos && has_alt)
-			{
-				break;
-			}
 		}
-		break;
-
-	case RAK12500_GNSS:
-		MYLOG("GNSS", "Polling RAK12500");
-		if (g_ble_uart_is_connected)
+		if (has_pos)
 		{
-			g_ble_uart.print("Polling RAK12500\n");
+			break;
 		}
+	}
+	return has_pos;
+}
 
-		if (my_rak12500_gnss.getGnssFixOk())
-		{
-			latitude = my_rak12500_gnss.getLatitude() / 100;
-			longitude = my_rak12500_gnss.getLongitude() / 100;
-			altitude = my_rak12500_gnss.getAltitude() / 1000;
-			accuracy = my_rak12500_gnss.getHorizontalDOP();
-			has_pos = true;
-		}
-		break;
+/**
+ * @brief Send a UBX message to the RAK1910
+ *
+ * @param msg_class message class
+ * @param msg_id message id
+ * @param payload message payload
+ * @param len payload length
+ */
+static void ubx_send(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t len)
+{
+	uint8_t header[6] = {0xB5, 0x62, msg_class, msg_id, (uint8_t)len, (uint8_t)(len >> 8)};
+	uint8_t ck_a = 0;
+	uint8_t ck_b = 0;
+	// Fletcher checksum over class, id, length and payload
+	for (uint16_t idx = 2; idx < 6; idx++)
+	{
+		ck_a += header[idx];
+		ck_b += ck_a;
+	}
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		ck_a += payload[idx];
+		ck_b += ck_a;
+	}
+	uint8_t checksum[2] = {ck_a, ck_b};
+	Serial1.write(header, sizeof(header));
+	Serial1.write(payload, len);
+	Serial1.write(checksum, sizeof(checksum));
+}
+
+/**
+ * @brief Write a profile to the RAK1910 with UBX-CFG-NAV5/RATE.
+ *        Only the values that differ from the active profile are written.
+ *        The MAX-7Q tracks either GPS or GLONASS, never both, so the
+ *        constellations stay at the GPS/QZSS/SBAS factory setting.
+ *        The UART carries NMEA, the ACK is not waited for.
+ *
+ * @param profile profile to write
+ * @return true always
+ */
+bool gnss_rak1910::apply(const gnss_profile_s &profile)
+{
+	if (applied_valid && gnss_profile_equal(applied, profile))
+	{
+		return true;
+	}
+
+	bool all = !applied_valid;
+	if (all || (applied.dyn_model != profile.dyn_model))
+	{
+		// UBX-CFG-NAV5, mask bit 0 = only the dynamic model is changed
+		uint8_t nav5[36] = {0};
+		nav5[0] = 0x01;
+		nav5[2] = profile.dyn_model;
+		ubx_send(0x06, 0x24, nav5, sizeof(nav5));
+	}
+	if (all || (applied.meas_ms != profile.meas_ms) || (applied.nav_rate != profile.nav_rate))
+	{
+		// UBX-CFG-RATE, measurement period, navigation rate, GPS time reference
+		uint8_t rate[6] = {(uint8_t)profile.meas_ms, (uint8_t)(profile.meas_ms >> 8), profile.nav_rate, 0, 1, 0};
+		ubx_send(0x06, 0x08, rate, sizeof(rate));
+	}
+
+	applied = profile;
+	applied_valid = true;
+	MYLOG("GNSS", "RAK1910 %s profile set", profile.name);
+	return true;
+}
+
+/** Route used by the replay backend, lat/long in 1e-7 degrees, altitude in meters */
+static const int32_t replay_route[][3] = {
+	{143586540, 1209841050, 12},
+	{143592870, 1209853300, 13},
+	{143601150, 1209866420, 15},
+	{143610730, 1209872180, 14},
+	{143619950, 1209869230, 12},
+	{143627410, 1209857760, 11},
+};
 
+/** Number of points in the replay route */
+#define REPLAY_ROUTE_LEN (sizeof(replay_route) / sizeof(replay_route[0]))
+
+/**
+ * @brief Start the replay backend
+ *
+ * @return true always
+ */
+bool gnss_replay::begin(void)
+{
+	route_idx = 0;
+	return true;
+}
+
+/**
+ * @brief Return the next point of the replay route
+ *
+ * @param fix filled with the next route point
+ * @return true always
+ */
+bool gnss_replay::poll(gnss_fix_s &fix)
+{
+	MYLOG("GNSS", "Polling replay route point %d", route_idx);
+	fix.lat_e7 = replay_route[route_idx][0];
+	fix.lon_e7 = replay_route[route_idx][1];
+	fix.alt_mm = replay_route[route_idx][2] * 1000;
+	fix.hdop_e2 = 100;
+	fix.sats = 8;
+	route_idx = (route_idx + 1) % REPLAY_ROUTE_LEN;
+	return true;
+}
+
+/**
+ * @brief The replay backend has nothing to configure
+ *
+ * @param profile profile to write
+ * @return true always
+ */
+bool gnss_replay::apply(const gnss_profile_s &profile)
+{
+	MYLOG("GNSS", "Replay %s profile", profile.name);
+	return true;
+}
+
+/**
+ * @brief Check GNSS module for position
+ * 
+ * @param gnss_option active backend
+ * @param result filled with the position, unchanged if none was found
+ * @return Is valid position found (bool)
+ */
+bool poll_gnss(uint8_t gnss_option, gnss_fix_s &result)
+{
+	bool has_pos = false;
+	gnss_fix_s fix;
+
+	// Write the profile if the scheduler changed it since the last poll
+	gnss_apply_profile(gnss_option);
+
+	digitalWrite(LED_BUILTIN, HIGH);
+
+	// Poll the GPS according to the initialized module
+	switch (gnss_option)
+	{
+	case RAK1910_GNSS:
+		has_pos = gnss_backend<gnss_rak1910>()->poll(fix);
+		break;
+	case RAK12500_GNSS:
+		has_pos = gnss_backend<gnss_rak12500>()->poll(fix);
+		break;
+	case REPLAY_GNSS:
+		has_pos = gnss_backend<gnss_replay>()->poll(fix);
+		break;
 	default:
 		MYLOG("GNSS", "No valid gnss_option provided");
 		if (g_ble_uart_is_connected)
@@ -184,49 +469,23 @@ bool poll_gnss(uint8_t gnss_option)
 
 	if (has_pos)
 	{
-		MYLOG("GNSS", "Lat: %.4fº Lon: %.4fº", latitude / 100000.0, longitude / 100000.0);
-		MYLOG("GNSS", "Alt: %d m", altitude);
-		MYLOG("GNSS", "Acy: %.2f ", accuracy / 100.0);
+		MYLOG("GNSS", "Lat: %.4fº Lon: %.4fº", fix.lat_e7 / 10000000.0, fix.lon_e7 / 10000000.0);
+		MYLOG("GNSS", "Alt: %.2f m", fix.alt_mm / 1000.0);
+		MYLOG("GNSS", "Acy: %.2f ", fix.hdop_e2 / 100.0);
 
 		if (g_ble_uart_is_connected)
 		{
-			g_ble_uart.printf("Lat: %.4fº Lon: %.4fº\n", latitude / 100000.0, longitude / 100000.0);
-			g_ble_uart.printf("Alt: %d m\n", altitude);
-			g_ble_uart.printf("Acy: %.2f\n", accuracy / 100.0);
+			g_ble_uart.printf("Lat: %.4fº Lon: %.4fº\n", fix.lat_e7 / 10000000.0, fix.lon_e7 / 10000000.0);
+			g_ble_uart.printf("Alt: %.2f m\n", fix.alt_mm / 1000.0);
+			g_ble_uart.printf("Acy: %.2f\n", fix.hdop_e2 / 100.0);
 		}
-		pos_union.val32 = latitude;
-		g_mapper_data.lat_1 = pos_union.val8[0];
-		g_mapper_data.lat_2 = pos_union.val8[1];
-		g_mapper_data.lat_3 = pos_union.val8[2];
-		g_mapper_data.lat_4 = pos_union.val8[3];
-
-		pos_union.val32 = longitude;
-		g_mapper_data.long_1 = pos_union.val8[0];
-		g_mapper_data.long_2 = pos_union.val8[1];
-		g_mapper_data.long_3 = pos_union.val8[2];
-		g_mapper_data.long_4 = pos_union.val8[3];
-
-		pos_union.val32 = altitude;
-		g_mapper_data.alt_1 = pos_union.val8[0];
-		g_mapper_data.alt_2 = pos_union.val8[1];
-
-		pos_union.val32 = accuracy;
-		g_mapper_data.acy_1 = pos_union.val8[0];
-		g_mapper_data.acy_2 = pos_union.val8[1];
-	}
-	else
-	{
-		delay(1000);
-	}
-
-	if (has_pos)
-	{
-		// my_rak1910_gnss.powerSaveMode(true);
-		// my_rak1910_gnss.setMeasurementRate(10000);
+		result = fix;
+		last_read_ok = true;
+		gnss_profile_fix(fix);
 		return true;
 	}
 
+	delay(1000);
 	last_read_ok = false;
-	// my_rak1910_gnss.setMeasurementRate(1000);
 	return false;
-}
\ No newline at end of file
+}
@@ -0,0 +1,87 @@
+/**
+ * @file gnss_backend.h
+ * @author agent (agent@local)
+ * @brief GNSS backend drivers. Only the detected backend is
+ *        constructed, inside a statically reserved arena in gnss.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef GNSS_BACKEND_H
+#define GNSS_BACKEND_H
+
+#include "app.h"
+#include "nmea.h"
+#include <SparkFun_u-blox_GNSS_Arduino_Library.h> // RAK12500_GNSS
+
+/**
+ * @brief RAK1910, u-blox MAX-7Q with NMEA output on Serial1
+ */
+class gnss_rak1910
+{
+public:
+	bool begin(void);
+	bool poll(gnss_fix_s &fix);
+	bool apply(const gnss_profile_s &profile);
+
+private:
+	nmea_parser parser;
+	/** Profile active in the module, valid only if applied_valid is set */
+	gnss_profile_s applied;
+	bool applied_valid = false;
+};
+
+/**
+ * @brief RAK12500, u-blox ZOE-M8Q with UBX output on I2C
+ */
+class gnss_rak12500
+{
+public:
+	bool begin(void);
+	bool poll(gnss_fix_s &fix);
+	bool apply(const gnss_profile_s &profile);
+
+private:
+	SFE_UBLOX_GNSS ublox;
+	/** Profile active in the module, valid only if applied_valid is set */
+	gnss_profile_s applied;
+	bool applied_valid = false;
+};
+
+/**
+ * @brief Replay backend, returns positions from a fixed route.
+ *        Used for bench testing without sky view.
+ */
+class gnss_replay
+{
+public:
+	bool begin(void);
+	bool poll(gnss_fix_s &fix);
+	bool apply(const gnss_profile_s &profile);
+
+private:
+	uint16_t route_idx = 0;
+};
+
+/**
+ * @brief Compile time maximum of the sizes/alignments of the backends
+ */
+template <size_t A, size_t... B>
+struct gnss_max_of
+{
+	static constexpr size_t value = A > gnss_max_of<B...>::value ? A : gnss_max_of<B...>::value;
+};
+
+template <size_t A>
+struct gnss_max_of<A>
+{
+	static constexpr size_t value = A;
+};
+
+#define GNSS_ARENA_SIZE gnss_max_of<sizeof(gnss_rak1910), sizeof(gnss_rak12500), sizeof(gnss_replay)>::value
+#define GNSS_ARENA_ALIGN gnss_max_of<alignof(gnss_rak1910), alignof(gnss_rak12500), alignof(gnss_replay)>::value
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * @file gnss_profile.cpp
+ * @author agent (agent@local)
+ * @brief GNSS configuration profiles (dynamic model, measurement rate,
+ *        constellations) and their selection from the motion state.
+ *        The backends write only the values that differ from the
+ *        profile that is already active in the module. The battery
+ *        policy stretches the measurement period on low charge.
+ *        A constellation change restarts the receiver and loses the
+ *        fix, automatic switches keep one set of constellations.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "geo.h"
+
+/** Constellations while moving, more satellites for urban canyons */
+#define GNSS_SYS_MOVING (GNSS_SYS_GPS | GNSS_SYS_GLONASS | GNSS_SYS_GALILEO | GNSS_SYS_QZSS)
+
+/** Profiles, indexed by GNSS_PROFILE_STATIONARY ... GNSS_PROFILE_AUTOMOTIVE */
+static const gnss_profile_s gnss_profiles[GNSS_PROFILE_NUM] = {
+	// Position does not change, slow measurements, fewer constellations save power
+	{"stationary", GNSS_DYN_STATIONARY, 2000, 1, GNSS_SYS_GPS | GNSS_SYS_GALILEO | GNSS_SYS_QZSS},
+	{"pedestrian", GNSS_DYN_PEDESTRIAN, 1000, 1, GNSS_SYS_MOVING},
+	{"automotive", GNSS_DYN_AUTOMOTIVE, 1000, 1, GNSS_SYS_MOVING},
+};
+
+/** Below this speed in mm/s the device is stationary */
+#define GNSS_SPEED_WALK 500
+/** Above this speed in mm/s the device is in a vehicle */
+#define GNSS_SPEED_DRIVE 7000
+/** Speed is only estimated from fixes at most this far apart (ms), longer gaps say nothing about the speed */
+#define GNSS_SPEED_MAX_GAP 300000
+/** Number of fixes in a row that must agree before the profile changes */
+#define GNSS_PROFILE_CONFIRM 2
+/** Longest measurement period in ms the battery policy stretches to */
+#define GNSS_MEAS_MAX_MS 10000
+
+/** Profile the scheduler selected */
+static uint8_t profile_id = GNSS_PROFILE_PEDESTRIAN;
+
+/** Selected profile with the battery policy applied */
+static gnss_profile_s active_profile;
+
+/** Profile the last fixes point to and how often in a row */
+static uint8_t candidate_id = GNSS_PROFILE_PEDESTRIAN;
+static uint8_t candidate_count = 0;
+
+/** Previous fix for the speed estimate */
+static gnss_fix_s prev_fix;
+static time_t prev_fix_time = 0;
+static bool prev_fix_valid = false;
+
+/**
+ * @brief Switch to a profile, the backend writes it before the next poll
+ *
+ * @param id profile id
+ */
+static void gnss_profile_switch(uint8_t id)
+{
+	if (id == profile_id)
+	{
+		return;
+	}
+	profile_id = id;
+	candidate_id = id;
+	candidate_count = 0;
+	AT_PRINTF("+EVT:GNSS PROFILE %s", gnss_profiles[id].name)
+	MYLOG("GNSS", "Switch to %s profile", gnss_profiles[id].name);
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.printf("GNSS profile %s\n", gnss_profiles[id].name);
+	}
+}
+
+/**
+ * @brief Apply the profile setting after boot or a settings change
+ *
+ */
+void gnss_profile_restart(void)
+{
+	candidate_count = 0;
+	prev_fix_valid = false;
+	if (g_mapper_settings.gnss_profile < GNSS_PROFILE_NUM)
+	{
+		gnss_profile_switch(g_mapper_settings.gnss_profile);
+	}
+}
+
+/**
+ * @brief Profile to use for the next poll. On low battery the
+ *        measurement period grows with the battery policy factor.
+ *        In auto mode the constellations of the moving profiles are
+ *        used for all profiles, they change only with the setting.
+ *
+ * @return const gnss_profile_s& profile
+ */
+const gnss_profile_s &gnss_profile(void)
+{
+	active_profile = gnss_profiles[profile_id];
+	if (g_mapper_settings.gnss_profile == GNSS_PROFILE_AUTO)
+	{
+		active_profile.systems = GNSS_SYS_MOVING;
+	}
+	uint32_t meas_ms = (uint32_t)active_profile.meas_ms * batt_interval_factor();
+	active_profile.meas_ms = meas_ms > GNSS_MEAS_MAX_MS ? GNSS_MEAS_MAX_MS : (uint16_t)meas_ms;
+	return active_profile;
+}
+
+/**
+ * @brief The accelerometer detected motion. The stationary dynamic
+ *        model would pin the position, leave it before the next poll.
+ *
+ */
+void gnss_profile_motion(void)
+{
+	if ((g_mapper_settings.gnss_profile == GNSS_PROFILE_AUTO) && (profile_id == GNSS_PROFILE_STATIONARY))
+	{
+		gnss_profile_switch(GNSS_PROFILE_PEDESTRIAN);
+	}
+}
+
+/**
+ * @brief Select the profile from the speed between the last two fixes
+ *
+ * @param fix new valid fix
+ */
+void gnss_profile_fix(const gnss_fix_s &fix)
+{
+	time_t now = millis();
+	time_t gap = now - prev_fix_time;
+	bool use_speed = prev_fix_valid && (gap >= 1000) && (gap <= GNSS_SPEED_MAX_GAP);
+	uint32_t dist_mm = 0;
+	uint16_t bearing = 0;
+	if (use_speed)
+	{
+		geo_delta(prev_fix.lat_e7, prev_fix.lon_e7, fix.lat_e7, fix.lon_e7, dist_mm, bearing);
+	}
+	prev_fix = fix;
+	prev_fix_time = now;
+	prev_fix_valid = true;
+
+	if ((g_mapper_settings.gnss_profile != GNSS_PROFILE_AUTO) || !use_speed)
+	{
+		return;
+	}
+
+	uint32_t speed_mm_s = (uint32_t)((uint64_t)dist_mm * 1000 / (uint32_t)gap);
+	uint8_t id = GNSS_PROFILE_PEDESTRIAN;
+	if (speed_mm_s < GNSS_SPEED_WALK)
+	{
+		id = GNSS_PROFILE_STATIONARY;
+	}
+	else if (speed_mm_s > GNSS_SPEED_DRIVE)
+	{
+		id = GNSS_PROFILE_AUTOMOTIVE;
+	}
+	MYLOG("GNSS", "Speed %ld mm/s", (long)speed_mm_s);
+
+	if (id == profile_id)
+	{
+		candidate_count = 0;
+		return;
+	}
+	if (id != candidate_id)
+	{
+		candidate_id = id;
+		candidate_count = 0;
+	}
+	if (++candidate_count >= GNSS_PROFILE_CONFIRM)
+	{
+		gnss_profile_switch(id);
+	}
+}
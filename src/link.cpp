@@ -0,0 +1,333 @@
+/**
+ * @file link.cpp
+ * @author agent (agent@local)
+ * @brief Link quality estimation from downlink RSSI/SNR and the ACK
+ *        rate of confirmed uplinks. Strong links move to faster data
+ *        rates, weak links use slower data rates, stop retries of
+ *        confirmed uplinks and stretch the send interval. The adapted
+ *        DR and confirmed state are kept here, the user settings in
+ *        g_lorawan_settings are never changed so save_settings() does
+ *        not store them.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Every Nth uplink is a confirmed probe with a LinkCheckReq */
+#define LINK_PROBE_EVERY 8
+
+/** Minimum uplinks between two DR changes */
+#define LINK_HOLD 4
+
+/** SNR margin in 1/16 dB below that the link is weak */
+#define LINK_WEAK_MARGIN_Q4 (3 * 16)
+
+/** SNR margin in 1/16 dB above that the link is strong */
+#define LINK_STRONG_MARGIN_Q4 (10 * 16)
+
+/** ACK rate in 1/256 below that the link is weak */
+#define LINK_WEAK_ACK 128
+
+/** ACK rate in 1/256 above that the link is strong */
+#define LINK_STRONG_ACK 230
+
+/** Maximum send interval factor on a weak link */
+#define LINK_MAX_FACTOR 4
+
+/** SNR margin average in 1/16 dB */
+static int16_t margin_q4 = 0;
+
+/** RSSI average in dBm */
+static int16_t rssi_avg = 0;
+
+/** Number of RSSI/SNR samples, saturates at 255 */
+static uint8_t rx_samples = 0;
+
+/** ACK rate average in 1/256, starts optimistic */
+static uint16_t ack_q8 = 256;
+
+/** Number of ACK samples, saturates at 255 */
+static uint8_t ack_samples = 0;
+
+/** Uplinks since the last probe */
+static uint8_t since_probe = 0;
+
+/** Uplinks since the last DR change */
+static uint8_t since_dr_change = 0;
+
+/** Flag if the running uplink is confirmed */
+static bool tx_confirmed = false;
+
+/** Flag if the running uplink belongs to a survey burst, it is not counted */
+static bool tx_survey = false;
+
+/** Start, data rate and payload length of the running uplink, to find the receive window of a downlink */
+static time_t tx_time = 0;
+static uint8_t tx_dr = 0;
+static uint8_t tx_len = 0;
+
+/** Flag if confirmed uplinks were turned off because of a weak link */
+static bool confirmed_off = false;
+
+/** Data rate set by the feedback loop, -1 if the configured data rate is used */
+static int16_t adapted_dr = -1;
+
+/** Configured data rate the adapted data rate is based on, a new configured data rate replaces it */
+static uint8_t adapted_from = 0;
+
+/** Current send interval factor */
+static uint8_t interval_factor = 1;
+
+/**
+ * @brief Data rate for uplinks outside of survey bursts
+ *
+ * @return uint8_t adapted data rate or the configured one
+ */
+uint8_t link_data_rate(void)
+{
+	if ((adapted_dr >= 0) && (adapted_from == g_lorawan_settings.data_rate))
+	{
+		return (uint8_t)adapted_dr;
+	}
+	return g_lorawan_settings.data_rate;
+}
+
+/**
+ * @brief Undo the changes of the feedback loop, used when it is disabled
+ *
+ */
+void link_reset(void)
+{
+	confirmed_off = false;
+	if ((adapted_dr >= 0) && (adapted_from == g_lorawan_settings.data_rate) && !g_lorawan_settings.adr_enabled)
+	{
+		lmh_datarate_set(g_lorawan_settings.data_rate, false);
+	}
+	adapted_dr = -1;
+	if (interval_factor != 1)
+	{
+		interval_factor = 1;
+		if (g_lorawan_settings.send_repeat_time != 0)
+		{
+			api_timer_restart(send_interval());
+		}
+	}
+	rx_samples = 0;
+	ack_samples = 0;
+	ack_q8 = 256;
+}
+
+/**
+ * @brief Fastest 125 kHz data rate of the configured region
+ *
+ * @return uint8_t data rate
+ */
+static uint8_t link_max_dr(void)
+{
+	switch ((LoRaMacRegion_t)g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+		return 3;
+	default:
+		return 5;
+	}
+}
+
+/**
+ * @brief Called before every uplink. Every LINK_PROBE_EVERY uplinks a
+ *        confirmed probe with a LinkCheckReq is sent to keep the ACK
+ *        rate up to date while confirmed uplinks are off.
+ *
+ * @param len payload length
+ * @return true send the uplink confirmed
+ * @return false send the uplink unconfirmed
+ */
+bool link_before_tx(uint8_t len)
+{
+	tx_time = millis();
+	tx_dr = lora_current_dr();
+	tx_len = len;
+	tx_confirmed = g_lorawan_settings.confirmed_msg_enabled && !confirmed_off;
+	tx_survey = survey_active();
+	if (g_mapper_settings.link_adapt && !tx_survey)
+	{
+		since_probe++;
+		if (since_probe >= LINK_PROBE_EVERY)
+		{
+			since_probe = 0;
+			MlmeReq_t mlme_req;
+			mlme_req.Type = MLME_LINK_CHECK;
+			LoRaMacMlmeRequest(&mlme_req);
+			tx_confirmed = true;
+			MYLOG("LINK", "Send link probe");
+		}
+	}
+	return tx_confirmed;
+}
+
+/**
+ * @brief Check if the last uplink was sent confirmed
+ *
+ * @return true confirmed uplink
+ */
+bool link_tx_confirmed(void)
+{
+	return tx_confirmed;
+}
+
+/**
+ * @brief Add a downlink RSSI/SNR sample
+ *
+ * @param rssi RSSI of the downlink in dBm
+ * @param snr SNR of the downlink in dB
+ * @param len payload length of the downlink
+ */
+void link_rx(int16_t rssi, int8_t snr, uint8_t len)
+{
+	// Burst uplinks use forced data rates, their downlinks say nothing about the normal DR
+	if (survey_active())
+	{
+		return;
+	}
+
+	uint8_t sf;
+	uint16_t bw_khz;
+	// RX1 and RX2 use different data rates, the margin depends on the window the downlink came in
+	lora_dr_params(lora_rx_dr(millis() - tx_time, tx_dr, tx_len, len), sf, bw_khz);
+	// Demodulation floor is -7.5 dB at SF7 and 2.5 dB lower per SF step
+	int16_t sample_q4 = snr * 16 + 120 + (sf - 7) * 40;
+
+	if (rx_samples == 0)
+	{
+		margin_q4 = sample_q4;
+		rssi_avg = rssi;
+	}
+	else
+	{
+		margin_q4 += (sample_q4 - margin_q4) / 4;
+		rssi_avg += (rssi - rssi_avg) / 4;
+	}
+	rx_samples = rx_samples < 255 ? rx_samples + 1 : 255;
+	MYLOG("LINK", "RSSI %d SNR %d, average margin %d dB", rssi, snr, margin_q4 / 16);
+}
+
+/**
+ * @brief TX cycle finished, update the ACK rate and adapt the link settings
+ *
+ * @param acked ACK received for a confirmed uplink
+ */
+void link_tx_finished(bool acked)
+{
+	if (!g_mapper_settings.link_adapt || tx_survey)
+	{
+		return;
+	}
+
+	if (tx_confirmed)
+	{
+		ack_q8 = ack_q8 - ack_q8 / 8 + (acked ? 256 / 8 : 0);
+		ack_samples = ack_samples < 255 ? ack_samples + 1 : 255;
+	}
+	since_dr_change = since_dr_change < 255 ? since_dr_change + 1 : 255;
+
+	bool weak = ((ack_samples >= 2) && (ack_q8 < LINK_WEAK_ACK)) || ((rx_samples != 0) && (margin_q4 < LINK_WEAK_MARGIN_Q4));
+	// Without downlinks the ACK rate alone decides, a too fast DR is taken back by the failing ACKs
+	bool strong = (ack_samples >= LINK_HOLD) && (ack_q8 >= LINK_STRONG_ACK) && ((rx_samples == 0) || (margin_q4 > LINK_STRONG_MARGIN_Q4));
+
+	// DR is only changed if the network does not control it with ADR
+	if (!g_lorawan_settings.adr_enabled && (since_dr_change >= LINK_HOLD))
+	{
+		uint8_t dr = lora_current_dr();
+		uint8_t new_dr = dr;
+		if (weak && (dr > 0))
+		{
+			new_dr = dr - 1;
+		}
+		else if (strong && (dr < link_max_dr()))
+		{
+			new_dr = dr + 1;
+		}
+		if ((new_dr != dr) && (lmh_datarate_set(new_dr, false) == LMH_SUCCESS))
+		{
+			// Survey bursts restore this DR
+			adapted_dr = new_dr;
+			adapted_from = g_lorawan_settings.data_rate;
+			since_dr_change = 0;
+			// Margin and ACK rate were measured on the old DR
+			rx_samples = 0;
+			ack_samples = 0;
+			AT_PRINTF("+EVT:LINK DR %d", new_dr);
+		}
+	}
+
+	// No retries on a weak link, they only cost airtime. The probes keep the ACK rate up to date.
+	if (weak && g_lorawan_settings.confirmed_msg_enabled && !confirmed_off)
+	{
+		confirmed_off = true;
+		AT_PRINTF("+EVT:LINK UNCONFIRMED");
+	}
+	else if (!weak && confirmed_off)
+	{
+		confirmed_off = false;
+		AT_PRINTF("+EVT:LINK CONFIRMED");
+	}
+
+	uint8_t factor = interval_factor;
+	if (weak && (factor < LINK_MAX_FACTOR))
+	{
+		factor *= 2;
+	}
+	else if (!weak && (factor > 1))
+	{
+		factor /= 2;
+	}
+	if ((factor != interval_factor) && (g_lorawan_settings.send_repeat_time != 0))
+	{
+		interval_factor = factor;
+		api_timer_restart(send_interval());
+		AT_PRINTF("+EVT:LINK INTERVAL %ld", (long)(send_interval() / 1000));
+	}
+}
+
+/**
+ * @brief SNR margin average
+ *
+ * @return int16_t margin in 1/16 dB
+ */
+int16_t link_margin_q4(void)
+{
+	return margin_q4;
+}
+
+/**
+ * @brief RSSI average
+ *
+ * @return int16_t RSSI in dBm
+ */
+int16_t link_rssi(void)
+{
+	return rssi_avg;
+}
+
+/**
+ * @brief ACK rate average
+ *
+ * @return uint8_t ACK rate in percent
+ */
+uint8_t link_ack_percent(void)
+{
+	return (uint8_t)(ack_q8 * 100 / 256);
+}
+
+/**
+ * @brief Current send interval factor
+ *
+ * @return uint8_t factor applied to the configured send interval
+ */
+uint8_t link_interval_factor(void)
+{
+	return interval_factor;
+}
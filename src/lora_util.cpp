@@ -0,0 +1,166 @@
+/**
+ * @file lora_util.cpp
+ * @author agent (agent@local)
+ * @brief LoRaWAN helpers for data rates, time on air and duty cycle
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** LoRaWAN overhead of an uplink, MHDR + FHDR + FPort + MIC */
+#define LORAWAN_OVERHEAD 13
+
+/**
+ * @brief Get the data rate the MAC uses for the next uplink
+ *
+ * @return uint8_t data rate
+ */
+uint8_t lora_current_dr(void)
+{
+	MibRequestConfirm_t mib_req;
+	mib_req.Type = MIB_CHANNELS_DATARATE;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) != LORAMAC_STATUS_OK)
+	{
+		return g_lorawan_settings.data_rate;
+	}
+	return (uint8_t)mib_req.Param.ChannelsDatarate;
+}
+
+/**
+ * @brief Spreading factor and bandwidth of a data rate in the configured region
+ *
+ * @param dr data rate
+ * @param sf spreading factor
+ * @param bw_khz bandwidth in kHz
+ */
+void lora_dr_params(uint8_t dr, uint8_t &sf, uint16_t &bw_khz)
+{
+	switch ((LoRaMacRegion_t)g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+		// DR8 ... DR13 are the downlink data rates
+		sf = dr < 4 ? 10 - dr : (dr < 8 ? 8 : 20 - dr);
+		bw_khz = dr < 4 ? 125 : 500;
+		break;
+	case LORAMAC_REGION_AU915:
+		sf = dr < 6 ? 12 - dr : (dr < 8 ? 8 : 20 - dr);
+		bw_khz = dr < 6 ? 125 : 500;
+		break;
+	default:
+		sf = dr < 6 ? 12 - dr : 7;
+		bw_khz = dr < 6 ? 125 : 250;
+		break;
+	}
+}
+
+/**
+ * @brief Time on air of an uplink, explicit header, CRC on, coding rate 4/5
+ *
+ * @param dr data rate
+ * @param len application payload length
+ * @return uint32_t time on air in ms
+ */
+uint32_t lora_airtime(uint8_t dr, uint8_t len)
+{
+	uint8_t sf;
+	uint16_t bw_khz;
+	lora_dr_params(dr, sf, bw_khz);
+
+	uint32_t symbol_us = ((uint32_t)1 << sf) * 1000 / bw_khz;
+	int32_t low_dr_opt = ((sf >= 11) && (bw_khz == 125)) ? 2 : 0;
+	int32_t bits = 8 * (len + LORAWAN_OVERHEAD) - 4 * sf + 28 + 16;
+	int32_t bits_per_block = 4 * (sf - low_dr_opt);
+	int32_t payload_symbols = 8 + (bits > 0 ? (bits + bits_per_block - 1) / bits_per_block * 5 : 0);
+	// Preamble 8 + 4.25 symbols, counted in quarter symbols
+	return symbol_us * (49 + 4 * payload_symbols) / 4000;
+}
+
+/**
+ * @brief RX1 data rate of an uplink data rate. The RX1 DR offset
+ *        is not known to the application, the default 0 is assumed.
+ *
+ * @param dr uplink data rate
+ * @return uint8_t downlink data rate in RX1
+ */
+static uint8_t lora_rx1_dr(uint8_t dr)
+{
+	switch ((LoRaMacRegion_t)g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+		return dr < 4 ? 10 + dr : 13;
+	case LORAMAC_REGION_AU915:
+		return dr < 6 ? 8 + dr : 13;
+	default:
+		return dr;
+	}
+}
+
+/**
+ * @brief Data rate of the receive window a downlink came in. The MAC
+ *        does not report the window, it is taken from the time between
+ *        the uplink and the downlink. The downlink ends at the opening
+ *        of its window plus its time on air, the nearer end wins.
+ *
+ * @param elapsed_ms time from enqueueing the uplink to the downlink
+ * @param up_dr data rate of the uplink
+ * @param up_len payload length of the uplink
+ * @param down_len payload length of the downlink
+ * @return uint8_t data rate of the downlink
+ */
+uint8_t lora_rx_dr(uint32_t elapsed_ms, uint8_t up_dr, uint8_t up_len, uint8_t down_len)
+{
+	uint8_t rx1_dr = lora_rx1_dr(up_dr);
+	MibRequestConfirm_t mib_req;
+	mib_req.Type = MIB_RX2_CHANNEL;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) != LORAMAC_STATUS_OK)
+	{
+		return rx1_dr;
+	}
+	uint8_t rx2_dr = mib_req.Param.Rx2Channel.Datarate;
+	if (rx2_dr == rx1_dr)
+	{
+		return rx1_dr;
+	}
+
+	uint32_t delay1 = 1000;
+	uint32_t delay2 = 2000;
+	mib_req.Type = MIB_RECEIVE_DELAY_1;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) == LORAMAC_STATUS_OK)
+	{
+		delay1 = mib_req.Param.ReceiveDelay1;
+	}
+	mib_req.Type = MIB_RECEIVE_DELAY_2;
+	if (LoRaMacMibGetRequestConfirm(&mib_req) == LORAMAC_STATUS_OK)
+	{
+		delay2 = mib_req.Param.ReceiveDelay2;
+	}
+
+	uint32_t up_toa = lora_airtime(up_dr, up_len);
+	uint32_t rx1_end = up_toa + delay1 + lora_airtime(rx1_dr, down_len);
+	uint32_t rx2_end = up_toa + delay2 + lora_airtime(rx2_dr, down_len);
+	uint32_t rx1_diff = elapsed_ms > rx1_end ? elapsed_ms - rx1_end : rx1_end - elapsed_ms;
+	uint32_t rx2_diff = elapsed_ms > rx2_end ? elapsed_ms - rx2_end : rx2_end - elapsed_ms;
+	return rx2_diff < rx1_diff ? rx2_dr : rx1_dr;
+}
+
+/**
+ * @brief Check if the region limits the duty cycle. The strictest
+ *        sub-band limit of 1% is assumed for all of them.
+ *
+ * @return true duty cycle limited region
+ */
+bool lora_duty_limited(void)
+{
+	switch ((LoRaMacRegion_t)g_lorawan_settings.lora_region)
+	{
+	case LORAMAC_REGION_US915:
+	case LORAMAC_REGION_AU915:
+	case LORAMAC_REGION_CN470:
+		return false;
+	default:
+		return true;
+	}
+}
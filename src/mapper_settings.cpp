@@ -0,0 +1,132 @@
+/**
+ * @file mapper_settings.cpp
+ * @author agent (agent@local)
+ * @brief Application settings, saved in the internal flash
+ *        next to the LoRaWAN settings of the WisBlock-API
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Application settings */
+mapper_settings_s g_mapper_settings;
+
+/** Name of the settings file */
+static const char settings_name[] = "MAPPER";
+
+/** File to save the settings */
+static File settings_file(InternalFS);
+
+/** Replace a field that is out of range with its default */
+#define SETTINGS_CHECK(field, min_value, max_value)                                        \
+	if (((long)settings.field < (long)(min_value)) || ((long)settings.field > (long)(max_value))) \
+	{                                                                                      \
+		MYLOG("SET", "Invalid " #field " %ld, using default", (long)settings.field);       \
+		settings.field = defaults.field;                                                   \
+		fixed++;                                                                           \
+	}
+
+/**
+ * @brief Check the loaded settings with the limits of the AT commands.
+ *        Fields out of range are set to their defaults.
+ *
+ * @param settings settings read from flash
+ * @return uint8_t number of fields that were replaced
+ */
+static uint8_t check_mapper_settings(mapper_settings_s &settings)
+{
+	const mapper_settings_s defaults;
+	uint8_t fixed = 0;
+	SETTINGS_CHECK(still_mode, STILL_POLL, STILL_SKIP)
+	SETTINGS_CHECK(fix_cache_time, 1, STILL_MAX_CACHE_TIME)
+	SETTINGS_CHECK(acc_false_wakes, 0, 3600)
+	SETTINGS_CHECK(survey_enable, 0, 1)
+	SETTINGS_CHECK(survey_gap, 0, 3600)
+	SETTINGS_CHECK(link_adapt, 0, 1)
+	SETTINGS_CHECK(batt_policy, 0, 1)
+	SETTINGS_CHECK(trigger_mode, 0, 1)
+	SETTINGS_CHECK(trigger_dist, 10, 65535)
+	SETTINGS_CHECK(trigger_heading, 5, 180)
+	SETTINGS_CHECK(trigger_poll, 1, 255)
+	SETTINGS_CHECK(trigger_max_hour, 1, 255)
+	SETTINGS_CHECK(gnss_profile, 0, GNSS_PROFILE_AUTO)
+
+	// The data rate list is replaced as a whole, survey_next() indexes it with survey_dr_count
+	bool drs_valid = settings.survey_dr_count <= SURVEY_MAX_DR;
+	for (uint8_t idx = 0; drs_valid && (idx < settings.survey_dr_count); idx++)
+	{
+		drs_valid = settings.survey_drs[idx] <= 15;
+	}
+	if (!drs_valid)
+	{
+		MYLOG("SET", "Invalid survey data rates, using defaults");
+		settings.survey_dr_count = defaults.survey_dr_count;
+		memcpy(settings.survey_drs, defaults.survey_drs, sizeof(settings.survey_drs));
+		fixed++;
+	}
+	return fixed;
+}
+
+/**
+ * @brief Read the application settings from flash.
+ *        Defaults are used if the file does not exist or
+ *        was written by a firmware with a different layout,
+ *        fields out of range are replaced by their defaults.
+ */
+void init_mapper_settings(void)
+{
+	mapper_settings_s flash_settings;
+
+	InternalFS.begin();
+	if (settings_file.open(settings_name, FILE_O_READ))
+	{
+		bool valid = settings_file.size() == sizeof(mapper_settings_s);
+		if (valid)
+		{
+			settings_file.read((uint8_t *)&flash_settings, sizeof(mapper_settings_s));
+			valid = (flash_settings.valid_mark_1 == 0xAA) && (flash_settings.valid_mark_2 == 0x55);
+		}
+		settings_file.close();
+		if (valid)
+		{
+			memcpy((void *)&g_mapper_settings, (void *)&flash_settings, sizeof(mapper_settings_s));
+			MYLOG("SET", "Application settings loaded");
+			if (check_mapper_settings(g_mapper_settings) != 0)
+			{
+				save_mapper_settings();
+			}
+			return;
+		}
+	}
+
+	MYLOG("SET", "No valid application settings, using defaults");
+	g_mapper_settings = mapper_settings_s();
+	save_mapper_settings();
+}
+
+/**
+ * @brief Save the application settings to flash
+ *
+ * @return true settings saved
+ * @return false file could not be written
+ */
+bool save_mapper_settings(void)
+{
+	InternalFS.remove(settings_name);
+	if (!settings_file.open(settings_name, FILE_O_WRITE))
+	{
+		MYLOG("SET", "Failed to save application settings");
+		return false;
+	}
+	settings_file.write((uint8_t *)&g_mapper_settings, sizeof(mapper_settings_s));
+	settings_file.close();
+	MYLOG("SET", "Application settings saved");
+	return true;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file mem_info.cpp
+ * @author agent (agent@local)
+ * @brief Runtime RAM headroom. Stack high-water marks of the FreeRTOS
+ *        tasks and the lowest free heap seen since boot.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Maximum number of tasks reported */
+#define MEM_MAX_TASKS 12
+
+/** Lowest free heap seen in bytes */
+static uint32_t heap_min_free = UINT32_MAX;
+
+/**
+ * @brief Free heap in bytes. The heap of the nRF52 core is the newlib
+ *        malloc heap, FreeRTOS allocates from it as well.
+ *
+ * @return uint32_t free heap in bytes
+ */
+uint32_t mem_heap_free(void)
+{
+	return (uint32_t)(dbgHeapTotal() - dbgHeapUsed());
+}
+
+/**
+ * @brief Update the lowest free heap. The heap does not track its
+ *        minimum itself, it is sampled on every application event.
+ *
+ */
+void mem_sample(void)
+{
+	uint32_t free_bytes = mem_heap_free();
+	if (free_bytes < heap_min_free)
+	{
+		heap_min_free = free_bytes;
+	}
+}
+
+/**
+ * @brief Lowest free heap seen since boot
+ *
+ * @return uint32_t free heap in bytes
+ */
+uint32_t mem_heap_min_free(void)
+{
+	mem_sample();
+	return heap_min_free;
+}
+
+/**
+ * @brief Unused stack of the calling task. The application event handler
+ *        and the AT commands both run in the loop task.
+ *
+ * @return uint32_t never used stack in bytes
+ */
+uint32_t mem_stack_free(void)
+{
+	return (uint32_t)uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t);
+}
+
+/**
+ * @brief Print the stack high-water mark of every task as
+ *        +MEM:<task>:<never used stack in bytes>
+ *
+ */
+void mem_print_tasks(void)
+{
+#if configUSE_TRACE_FACILITY == 1
+	static TaskStatus_t tasks[MEM_MAX_TASKS];
+	UBaseType_t count = uxTaskGetSystemState(tasks, MEM_MAX_TASKS, NULL);
+	if (count == 0)
+	{
+		AT_PRINTF("+MEM:more than %d tasks", MEM_MAX_TASKS);
+		return;
+	}
+	for (UBaseType_t idx = 0; idx < count; idx++)
+	{
+		AT_PRINTF("+MEM:%s:%ld", tasks[idx].pcTaskName, (long)(tasks[idx].usStackHighWaterMark * sizeof(StackType_t)));
+	}
+#else
+	AT_PRINTF("+MEM:loop:%ld", (long)mem_stack_free());
+#endif
+}
@@ -0,0 +1,397 @@
+/**
+ * @file nmea.cpp
+ * @author agent (agent@local)
+ * @brief Character state machine of the NMEA parser. Checks the
+ *        checksum and converts the fields of GGA, RMC and GSA to
+ *        fixed point while they arrive.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "nmea.h"
+
+/** Maximum number of fraction digits kept per field, keeps ddmm.mmmmm inside 32 bit */
+#define NMEA_MAX_FRAC 5
+
+/** Sentence type tags, last three characters of the address field */
+#define NMEA_TAG(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+#define TAG_GGA NMEA_TAG('G', 'G', 'A')
+#define TAG_RMC NMEA_TAG('R', 'M', 'C')
+#define TAG_GSA NMEA_TAG('G', 'S', 'A')
+
+/** Largest field value that can take one more digit without leaving 32 bit */
+#define NMEA_MAX_VALUE ((UINT32_MAX - 9) / 10)
+
+/** Powers of 10 for fraction scaling */
+static const uint32_t pow10_tab[NMEA_MAX_FRAC + 1] = {1, 10, 100, 1000, 10000, 100000};
+
+/**
+ * @brief Rescale a value with frac fraction digits to digits fraction digits
+ *
+ * @param value accumulated digits
+ * @param frac number of fraction digits in value
+ * @param digits wanted number of fraction digits
+ * @return uint32_t rescaled value, UINT32_MAX if it does not fit 32 bit
+ */
+static uint32_t nmea_scale(uint32_t value, uint8_t frac, uint8_t digits)
+{
+	while (frac < digits)
+	{
+		if (value > UINT32_MAX / 10)
+		{
+			return UINT32_MAX;
+		}
+		value *= 10;
+		frac++;
+	}
+	while (frac > digits)
+	{
+		value /= 10;
+		frac--;
+	}
+	return value;
+}
+
+/**
+ * @brief Limit a value to 16 bit
+ */
+static inline uint16_t nmea_u16(uint32_t value)
+{
+	return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+/**
+ * @brief Convert a (d)ddmm.mmmmm field into 1e-7 degrees
+ *
+ * @param value accumulated digits
+ * @param frac number of fraction digits in value
+ * @return int32_t unsigned coordinate in 1e-7 degrees, INT32_MAX if invalid
+ */
+static int32_t nmea_coord(uint32_t value, uint8_t frac)
+{
+	uint32_t whole = value / pow10_tab[frac];
+	if ((whole / 100 > 180) || (whole % 100 >= 60))
+	{
+		// Out of range or invalid minutes, rejected by check_coord()
+		return INT32_MAX;
+	}
+	uint32_t minutes_e5 = (whole % 100) * 100000 + nmea_scale(value % pow10_tab[frac], frac, 5);
+	// 1e-5 minutes to 1e-7 degrees is * 100 / 60
+	return (int32_t)((whole / 100) * 10000000 + (minutes_e5 * 5 + 1) / 3);
+}
+
+/**
+ * @brief Convert an ASCII hex digit
+ *
+ * @param c character
+ * @return int value 0 to 15 or -1 if not a hex digit
+ */
+static int nmea_hex(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+/**
+ * @brief Feed one character into the parser
+ *
+ * @param c received character
+ * @return uint8_t NMEA_GGA, NMEA_RMC or NMEA_GSA when a sentence with a
+ *         valid checksum was completed, NMEA_NONE otherwise
+ */
+uint8_t nmea_parser::encode(char c)
+{
+	if (c == '$')
+	{
+		in_sentence = true;
+		in_checksum = false;
+		checksum = 0;
+		field_idx = 0;
+		sentence = NMEA_NONE;
+		type_tag = 0;
+		pending = data;
+		reset_field();
+		return NMEA_NONE;
+	}
+
+	if (!in_sentence)
+	{
+		return NMEA_NONE;
+	}
+
+	if (in_checksum)
+	{
+		int nibble = nmea_hex(c);
+		if (nibble < 0)
+		{
+			in_sentence = false;
+			return NMEA_NONE;
+		}
+		rx_checksum = (rx_checksum << 4) | (uint8_t)nibble;
+		if (++checksum_digits < 2)
+		{
+			return NMEA_NONE;
+		}
+		in_sentence = false;
+		if (rx_checksum != checksum)
+		{
+			failed_checksum++;
+			return NMEA_NONE;
+		}
+		if (sentence == NMEA_NONE)
+		{
+			return NMEA_NONE;
+		}
+		passed_checksum++;
+		data = pending;
+		return sentence;
+	}
+
+	if (c == '*')
+	{
+		end_field();
+		in_checksum = true;
+		rx_checksum = 0;
+		checksum_digits = 0;
+		return NMEA_NONE;
+	}
+
+	if ((c == '\r') || (c == '\n'))
+	{
+		// Sentences without checksum are not accepted
+		in_sentence = false;
+		return NMEA_NONE;
+	}
+
+	checksum ^= (uint8_t)c;
+
+	if (c == ',')
+	{
+		end_field();
+		field_idx++;
+		reset_field();
+		return NMEA_NONE;
+	}
+
+	if (field_idx == 0)
+	{
+		type_tag = ((type_tag << 8) | (uint8_t)c) & 0x00FFFFFF;
+		return NMEA_NONE;
+	}
+
+	// Sentences we do not decode only need the checksum
+	if (sentence == NMEA_NONE)
+	{
+		return NMEA_NONE;
+	}
+
+	if (field_len == 0)
+	{
+		field_first = c;
+	}
+	field_len++;
+
+	if ((c >= '0') && (c <= '9'))
+	{
+		if (field_dot && (field_frac >= NMEA_MAX_FRAC))
+		{
+			// Further fraction digits are below the resolution
+			return NMEA_NONE;
+		}
+		if (field_value > NMEA_MAX_VALUE)
+		{
+			// Integer and fraction digits together overflow, drop the sentence instead of decoding a wrapped value
+			sentence = NMEA_NONE;
+			return NMEA_NONE;
+		}
+		field_value = field_value * 10 + (c - '0');
+		field_frac += field_dot ? 1 : 0;
+	}
+	else if (c == '.')
+	{
+		field_dot = true;
+	}
+	else if (c == '-')
+	{
+		field_neg = true;
+	}
+	return NMEA_NONE;
+}
+
+/**
+ * @brief Clear the field accumulator
+ *
+ */
+void nmea_parser::reset_field(void)
+{
+	field_value = 0;
+	field_frac = 0;
+	field_first = 0;
+	field_len = 0;
+	field_dot = false;
+	field_neg = false;
+}
+
+/**
+ * @brief Drop the sentence if a coordinate is out of range
+ *
+ * @param value_e7 unsigned coordinate in 1e-7 degrees
+ * @param max_e7 largest valid value
+ */
+void nmea_parser::check_coord(int32_t value_e7, int32_t max_e7)
+{
+	if (value_e7 > max_e7)
+	{
+		sentence = NMEA_NONE;
+	}
+}
+
+/**
+ * @brief Store a completed field into the pending values
+ *
+ */
+void nmea_parser::end_field(void)
+{
+	if (field_idx == 0)
+	{
+		switch (type_tag)
+		{
+		case TAG_GGA:
+			sentence = NMEA_GGA;
+			break;
+		case TAG_RMC:
+			sentence = NMEA_RMC;
+			break;
+		case TAG_GSA:
+			sentence = NMEA_GSA;
+			break;
+		default:
+			sentence = NMEA_NONE;
+			break;
+		}
+		return;
+	}
+
+	switch (sentence)
+	{
+	case NMEA_GGA:
+		switch (field_idx)
+		{
+		case 1:
+			pending.time_hms = field_value / pow10_tab[field_frac];
+			break;
+		case 2:
+			pending.lat_e7 = nmea_coord(field_value, field_frac);
+			check_coord(pending.lat_e7, 900000000);
+			break;
+		case 3:
+			if (field_first == 'S')
+			{
+				pending.lat_e7 = -pending.lat_e7;
+			}
+			break;
+		case 4:
+			pending.lon_e7 = nmea_coord(field_value, field_frac);
+			check_coord(pending.lon_e7, 1800000000);
+			break;
+		case 5:
+			if (field_first == 'W')
+			{
+				pending.lon_e7 = -pending.lon_e7;
+			}
+			break;
+		case 6:
+			pending.quality = (uint8_t)field_value;
+			break;
+		case 7:
+			pending.sats = (uint8_t)field_value;
+			break;
+		case 8:
+			pending.hdop_e2 = nmea_u16(nmea_scale(field_value, field_frac, 2));
+			break;
+		case 9:
+		{
+			uint32_t alt_mm = nmea_scale(field_value, field_frac, 3);
+			if (alt_mm > INT32_MAX)
+			{
+				// Beyond 2147 km, not a valid altitude
+				sentence = NMEA_NONE;
+				break;
+			}
+			pending.alt_mm = (int32_t)alt_mm;
+			if (field_neg)
+			{
+				pending.alt_mm = -pending.alt_mm;
+			}
+			break;
+		}
+		}
+		break;
+
+	case NMEA_RMC:
+		switch (field_idx)
+		{
+		case 1:
+			pending.time_hms = field_value / pow10_tab[field_frac];
+			break;
+		case 2:
+			pending.rmc_valid = (field_first == 'A');
+			break;
+		case 3:
+			pending.lat_e7 = nmea_coord(field_value, field_frac);
+			check_coord(pending.lat_e7, 900000000);
+			break;
+		case 4:
+			if (field_first == 'S')
+			{
+				pending.lat_e7 = -pending.lat_e7;
+			}
+			break;
+		case 5:
+			pending.lon_e7 = nmea_coord(field_value, field_frac);
+			check_coord(pending.lon_e7, 1800000000);
+			break;
+		case 6:
+			if (field_first == 'W')
+			{
+				pending.lon_e7 = -pending.lon_e7;
+			}
+			break;
+		case 7:
+			pending.speed_e2 = nmea_u16(nmea_scale(field_value, field_frac, 2));
+			break;
+		case 8:
+			pending.course_e2 = nmea_u16(nmea_scale(field_value, field_frac, 2));
+			break;
+		case 9:
+			pending.date_dmy = field_value;
+			break;
+		}
+		break;
+
+	case NMEA_GSA:
+		switch (field_idx)
+		{
+		case 2:
+			pending.fix_type = (uint8_t)field_value;
+			break;
+		case 15:
+			pending.pdop_e2 = nmea_u16(nmea_scale(field_value, field_frac, 2));
+			break;
+		}
+		break;
+	}
+}
@@ -0,0 +1,85 @@
+/**
+ * @file nmea.h
+ * @author agent (agent@local)
+ * @brief Streaming NMEA parser, decodes only GGA, RMC and GSA
+ *        into fixed point values. No buffers, no floating point.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stdint.h>
+
+/** Sentence types, returned by nmea_parser::encode() */
+#define NMEA_NONE 0x00
+#define NMEA_GGA 0x01
+#define NMEA_RMC 0x02
+#define NMEA_GSA 0x04
+
+/** Decoded values, updated only from sentences with a valid checksum */
+struct nmea_data_s
+{
+	int32_t lat_e7 = 0;		 // Latitude in 1e-7 degrees
+	int32_t lon_e7 = 0;		 // Longitude in 1e-7 degrees
+	int32_t alt_mm = 0;		 // Altitude above MSL in millimeters (GGA)
+	uint32_t time_hms = 0;	 // UTC time as hhmmss
+	uint32_t date_dmy = 0;	 // UTC date as ddmmyy (RMC)
+	uint16_t hdop_e2 = 0;	 // HDOP * 100 (GGA)
+	uint16_t pdop_e2 = 0;	 // PDOP * 100 (GSA)
+	uint16_t speed_e2 = 0;	 // Speed over ground in knots * 100 (RMC)
+	uint16_t course_e2 = 0;	 // Course over ground in degrees * 100 (RMC)
+	uint8_t sats = 0;		 // Satellites used (GGA)
+	uint8_t quality = 0;	 // GGA fix quality, 0 = no fix
+	uint8_t fix_type = 0;	 // GSA fix type, 1 = none, 2 = 2D, 3 = 3D
+	bool rmc_valid = false;	 // RMC status 'A'
+};
+
+/**
+ * @brief Byte-wise NMEA decoder. Each field is accumulated as an
+ *        integer with a count of fraction digits while it streams in,
+ *        so no sentence or field buffer is needed.
+ */
+class nmea_parser
+{
+public:
+	uint8_t encode(char c);
+
+	/** Latest decoded values */
+	nmea_data_s data;
+	/** Sentences with a bad checksum */
+	uint32_t failed_checksum = 0;
+	/** Sentences accepted */
+	uint32_t passed_checksum = 0;
+
+private:
+	void end_field(void);
+	void reset_field(void);
+	void check_coord(int32_t value_e7, int32_t max_e7);
+
+	/** Values of the sentence in progress, copied to data on valid checksum */
+	nmea_data_s pending;
+
+	uint32_t field_value = 0;
+	uint8_t field_frac = 0;
+	uint8_t field_first = 0;
+	uint8_t field_len = 0;
+	bool field_dot = false;
+	bool field_neg = false;
+
+	uint8_t field_idx = 0;
+	uint8_t sentence = NMEA_NONE;
+	uint8_t checksum = 0;
+	uint8_t rx_checksum = 0;
+	uint8_t checksum_digits = 0;
+	bool in_sentence = false;
+	bool in_checksum = false;
+	/** Last three characters of the address field, packed */
+	uint32_t type_tag = 0;
+};
+
+#endif
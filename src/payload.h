@@ -0,0 +1,367 @@
+/**
+ * @file payload.h
+ * @author agent (agent@local)
+ * @brief Compile time payload codec. Each uplink format is described
+ *        once as a list of fields, the encoder used by the firmware and
+ *        the decoder used by host tools are generated from it.
+ *        tools/mapper_decode includes this header for its batch decoder.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stdint.h>
+
+/** Values that can be carried in a payload, in the native units of the firmware */
+struct payload_values_s
+{
+	int32_t lat_e7 = 0;	  // Latitude in 1e-7 degrees
+	int32_t lon_e7 = 0;	  // Longitude in 1e-7 degrees
+	int32_t alt_mm = 0;	  // Altitude in millimeters
+	uint16_t hdop_e2 = 0; // HDOP * 100
+	uint8_t sats = 0;	  // Satellites used in fix
+	uint16_t batt_mv = 0; // Battery voltage in millivolts
+	uint16_t age_min = 0; // Age of the position in minutes
+	uint8_t dr = 0;		  // Data rate the uplink was sent with
+	uint16_t seq = 0;	  // Survey burst sequence number
+};
+
+/** Value slots a field can be bound to */
+enum payload_slot_e
+{
+	PL_LAT,
+	PL_LON,
+	PL_ALT,
+	PL_HDOP,
+	PL_SATS,
+	PL_BATT,
+	PL_AGE,
+	PL_DR,
+	PL_SEQ,
+};
+
+/** Byte order of a field */
+enum payload_endian_e
+{
+	PL_LE,
+	PL_BE,
+};
+
+/**
+ * @brief Read a slot from the values
+ */
+static inline int64_t payload_get(const payload_values_s &values, payload_slot_e slot)
+{
+	switch (slot)
+	{
+	case PL_LAT:
+		return values.lat_e7;
+	case PL_LON:
+		return values.lon_e7;
+	case PL_ALT:
+		return values.alt_mm;
+	case PL_HDOP:
+		return values.hdop_e2;
+	case PL_SATS:
+		return values.sats;
+	case PL_BATT:
+		return values.batt_mv;
+	case PL_AGE:
+		return values.age_min;
+	case PL_DR:
+		return values.dr;
+	case PL_SEQ:
+		return values.seq;
+	}
+	return 0;
+}
+
+/**
+ * @brief Write a slot into the values
+ */
+static inline void payload_set(payload_values_s &values, payload_slot_e slot, int64_t value)
+{
+	switch (slot)
+	{
+	case PL_LAT:
+		values.lat_e7 = (int32_t)value;
+		break;
+	case PL_LON:
+		values.lon_e7 = (int32_t)value;
+		break;
+	case PL_ALT:
+		values.alt_mm = (int32_t)value;
+		break;
+	case PL_HDOP:
+		values.hdop_e2 = (uint16_t)value;
+		break;
+	case PL_SATS:
+		values.sats = (uint8_t)value;
+		break;
+	case PL_BATT:
+		values.batt_mv = (uint16_t)value;
+		break;
+	case PL_AGE:
+		values.age_min = (uint16_t)value;
+		break;
+	case PL_DR:
+		values.dr = (uint8_t)value;
+		break;
+	case PL_SEQ:
+		values.seq = (uint16_t)value;
+		break;
+	}
+}
+
+/**
+ * @brief One payload field
+ *
+ * @tparam Slot value carried by the field
+ * @tparam Bits field width, multiple of 8, up to 32
+ * @tparam Signed two's complement field
+ * @tparam Div the value is divided by Div before it is stored
+ * @tparam Endian byte order
+ */
+template <payload_slot_e Slot, uint8_t Bits, bool Signed, int32_t Div = 1, payload_endian_e Endian = PL_LE>
+struct pl_field
+{
+	static_assert((Bits % 8 == 0) && (Bits >= 8) && (Bits <= 32), "Field width must be 8, 16, 24 or 32 bit");
+	static_assert(Div > 0, "Field divider must be positive");
+
+	static constexpr uint8_t size = Bits / 8;
+	static constexpr int64_t min_val = Signed ? -((int64_t)1 << (Bits - 1)) : 0;
+	static constexpr int64_t max_val = Signed ? ((int64_t)1 << (Bits - 1)) - 1 : ((int64_t)1 << Bits) - 1;
+
+	/**
+	 * @brief Scale and saturate the value, write it to buf
+	 */
+	static inline void encode(uint8_t *buf, const payload_values_s &values)
+	{
+		int64_t raw = payload_get(values, Slot) / Div;
+		if (raw < min_val)
+		{
+			raw = min_val;
+		}
+		else if (raw > max_val)
+		{
+			raw = max_val;
+		}
+		uint32_t bits = (uint32_t)raw;
+		for (uint8_t idx = 0; idx < size; idx++)
+		{
+			buf[Endian == PL_LE ? idx : size - 1 - idx] = (uint8_t)(bits >> (8 * idx));
+		}
+	}
+
+	/**
+	 * @brief Read the field from buf, sign extend and scale back
+	 */
+	static inline void decode(const uint8_t *buf, payload_values_s &values)
+	{
+		uint32_t bits = 0;
+		for (uint8_t idx = 0; idx < size; idx++)
+		{
+			bits |= (uint32_t)buf[Endian == PL_LE ? idx : size - 1 - idx] << (8 * idx);
+		}
+		int64_t raw = bits;
+		if (Signed && (bits & ((uint32_t)1 << (Bits - 1))))
+		{
+			raw -= (int64_t)1 << Bits;
+		}
+		payload_set(values, Slot, raw * Div);
+	}
+};
+
+/**
+ * @brief Field list, recursion over the fields of a format
+ */
+template <typename... Fields>
+struct pl_fields;
+
+template <>
+struct pl_fields<>
+{
+	static constexpr uint8_t size = 0;
+	static inline void encode(uint8_t *, const payload_values_s &) {}
+	static inline void decode(const uint8_t *, payload_values_s &) {}
+};
+
+template <typename First, typename... Rest>
+struct pl_fields<First, Rest...>
+{
+	static constexpr uint8_t size = First::size + pl_fields<Rest...>::size;
+
+	static inline void encode(uint8_t *buf, const payload_values_s &values)
+	{
+		First::encode(buf, values);
+		pl_fields<Rest...>::encode(buf + First::size, values);
+	}
+
+	static inline void decode(const uint8_t *buf, payload_values_s &values)
+	{
+		First::decode(buf, values);
+		pl_fields<Rest...>::decode(buf + First::size, values);
+	}
+};
+
+/**
+ * @brief A versioned payload format
+ *
+ * @tparam Fport LoRaWAN port the format is sent on, 0 = configured application port
+ * @tparam Fields the fields in transmission order
+ */
+template <uint8_t Fport, typename... Fields>
+struct pl_format
+{
+	static constexpr uint8_t fport = Fport;
+	static constexpr uint8_t size = pl_fields<Fields...>::size;
+
+	/**
+	 * @brief Encode the values into buf, buf must hold at least size bytes
+	 *
+	 * @return uint8_t number of bytes written
+	 */
+	static inline uint8_t encode(uint8_t *buf, const payload_values_s &values)
+	{
+		pl_fields<Fields...>::encode(buf, values);
+		return size;
+	}
+
+	/**
+	 * @brief Decode buf into values
+	 *
+	 * @return true if len matches the format size
+	 */
+	static inline bool decode(const uint8_t *buf, uint8_t len, payload_values_s &values)
+	{
+		if (len != size)
+		{
+			return false;
+		}
+		pl_fields<Fields...>::decode(buf, values);
+		return true;
+	}
+};
+
+/** LoRaWAN ports of the versioned formats */
+#define MAPPER_FPORT_V2 4
+#define MAPPER_FPORT_STILL 5
+#define MAPPER_FPORT_SURVEY 7
+#define MAPPER_FPORT_COMPACT 8
+
+/**
+ * @brief Format V1, the original 14 byte Helium mapper layout, sent on the
+ *        configured application port. Lat/long in 1e-5 degrees, altitude in
+ *        meters, HDOP * 100, battery in mV, all little endian. The altitude
+ *        is two's complement like the low 16 bits the original firmware sent,
+ *        below sea level is 0xFFFF for -1 m, not 0.
+ */
+typedef pl_format<0,
+				  pl_field<PL_LAT, 32, true, 100>,
+				  pl_field<PL_LON, 32, true, 100>,
+				  pl_field<PL_ALT, 16, true, 1000>,
+				  pl_field<PL_HDOP, 16, false>,
+				  pl_field<PL_BATT, 16, false>>
+	payload_v1;
+
+/**
+ * @brief Format V2, full precision. Lat/long in 1e-7 degrees, signed altitude
+ *        in decimeters, HDOP * 10, satellites, battery in mV, all big endian.
+ */
+typedef pl_format<MAPPER_FPORT_V2,
+				  pl_field<PL_LAT, 32, true, 1, PL_BE>,
+				  pl_field<PL_LON, 32, true, 1, PL_BE>,
+				  pl_field<PL_ALT, 24, true, 100, PL_BE>,
+				  pl_field<PL_HDOP, 8, false, 10, PL_BE>,
+				  pl_field<PL_SATS, 8, false, 1, PL_BE>,
+				  pl_field<PL_BATT, 16, false, 1, PL_BE>>
+	payload_v2;
+
+/**
+ * @brief Heartbeat of a device that did not move. Cached lat/long in 1e-5
+ *        degrees, age of the position in minutes, battery in mV, little endian.
+ */
+typedef pl_format<MAPPER_FPORT_STILL,
+				  pl_field<PL_LAT, 32, true, 100>,
+				  pl_field<PL_LON, 32, true, 100>,
+				  pl_field<PL_AGE, 16, false>,
+				  pl_field<PL_BATT, 16, false>>
+	payload_still;
+
+/**
+ * @brief One uplink of a multi data rate survey burst. Lat/long in 1e-5
+ *        degrees, data rate used, burst sequence number, little endian.
+ *        11 bytes, fits the smallest maximum payload of all regions.
+ */
+typedef pl_format<MAPPER_FPORT_SURVEY,
+				  pl_field<PL_LAT, 32, true, 100>,
+				  pl_field<PL_LON, 32, true, 100>,
+				  pl_field<PL_DR, 8, false>,
+				  pl_field<PL_SEQ, 16, false>>
+	payload_survey;
+
+/**
+ * @brief Compact fix for data rates that cannot carry the full format.
+ *        Lat in 108e-7 degrees and long in 215e-7 degrees (about 1.2 m and
+ *        2.4 m at the equator), HDOP * 10, little endian.
+ */
+typedef pl_format<MAPPER_FPORT_COMPACT,
+				  pl_field<PL_LAT, 24, true, 108>,
+				  pl_field<PL_LON, 24, true, 215>,
+				  pl_field<PL_HDOP, 8, false, 10>>
+	payload_compact;
+
+static_assert(payload_survey::size <= 11, "Survey uplink must fit DR0 of US915");
+static_assert(payload_v1::size == 14, "V1 layout must stay 14 bytes");
+
+/**
+ * @brief Compile time maximum of the format sizes
+ */
+template <uint8_t A, uint8_t... B>
+struct pl_max_size
+{
+	static constexpr uint8_t value = A > pl_max_size<B...>::value ? A : pl_max_size<B...>::value;
+};
+
+template <uint8_t A>
+struct pl_max_size<A>
+{
+	static constexpr uint8_t value = A;
+};
+
+/** Largest payload of all formats, a new format must be added here */
+#define PAYLOAD_MAX_LEN pl_max_size<payload_v1::size, payload_v2::size, payload_still::size, \
+									payload_survey::size, payload_compact::size>::value
+
+/**
+ * @brief Decode a received uplink by its port
+ *
+ * @param fport LoRaWAN port of the uplink
+ * @param buf payload
+ * @param len payload length
+ * @param values decoded values
+ * @return true if a format matched
+ */
+static inline bool payload_decode(uint8_t fport, const uint8_t *buf, uint8_t len, payload_values_s &values)
+{
+	switch (fport)
+	{
+	case MAPPER_FPORT_V2:
+		return payload_v2::decode(buf, len, values);
+	case MAPPER_FPORT_STILL:
+		return payload_still::decode(buf, len, values);
+	case MAPPER_FPORT_SURVEY:
+		return payload_survey::decode(buf, len, values);
+	case MAPPER_FPORT_COMPACT:
+		return payload_compact::decode(buf, len, values);
+	default:
+		return payload_v1::decode(buf, len, values);
+	}
+}
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file survey.cpp
+ * @author agent (agent@local)
+ * @brief Multi data rate survey. In every new coverage cell a burst of
+ *        small uplinks is sent, one on each configured data rate, all
+ *        with the same fix. The uplinks are spaced to keep the duty cycle.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/** Shortest time between two burst uplinks in ms, keeps the TX cycle with RX windows free */
+#define SURVEY_MIN_GAP 5000
+
+/** Timer for the next uplink of a burst */
+SoftwareTimer survey_timer;
+
+/** Payload buffer of the burst uplinks */
+static uint8_t survey_payload[PAYLOAD_MAX_LEN];
+
+/** Fix of the running burst */
+static payload_values_s survey_values;
+
+/** Flag if a burst is running, stays set until the TX cycle of its last uplink finished */
+static bool survey_running = false;
+
+/** Next entry of survey_drs to send */
+static uint8_t survey_step = 0;
+
+/** Burst sequence number */
+static uint16_t survey_seq = 0;
+
+/** Start time of the last burst uplink */
+static time_t survey_tx_start = 0;
+
+/** Time on air of the last burst uplink in ms */
+static uint32_t survey_toa = 0;
+
+/** Cell of the last burst */
+static coverage_cell_s survey_cell = {INT32_MAX, INT32_MAX};
+
+/**
+ * @brief Timer callback, wake the loop to send the next burst uplink
+ *
+ * @param unused
+ */
+static void survey_timer_cb(TimerHandle_t unused)
+{
+	g_task_event_type |= SURVEY_TRIGGER;
+	xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Restore the data rate and ADR setting after a burst
+ *
+ */
+static void survey_stop(void)
+{
+	survey_timer.stop();
+	survey_running = false;
+	survey_step = 0;
+	lmh_datarate_set(link_data_rate(), g_lorawan_settings.adr_enabled);
+}
+
+/**
+ * @brief Initialize the burst timer
+ *
+ */
+void init_survey(void)
+{
+	survey_timer.begin(SURVEY_MIN_GAP, survey_timer_cb, NULL, false);
+}
+
+/**
+ * @brief Start a burst if survey mode is enabled and the fix is in a new cell
+ *
+ * @param fix position to send in all burst uplinks
+ * @return true burst started, the normal uplink is replaced by the burst
+ * @return false no burst
+ */
+bool survey_start(gnss_fix_s &fix)
+{
+	if (!g_mapper_settings.survey_enable || (g_mapper_settings.survey_dr_count == 0) || survey_active())
+	{
+		return false;
+	}
+
+	coverage_cell_s cell = coverage_cell(fix.lat_e7, fix.lon_e7);
+	if ((cell.lat_q == survey_cell.lat_q) && (cell.lon_q == survey_cell.lon_q))
+	{
+		return false;
+	}
+	survey_cell = cell;
+
+	survey_values = payload_values_s();
+	survey_values.lat_e7 = fix.lat_e7;
+	survey_values.lon_e7 = fix.lon_e7;
+	survey_values.seq = ++survey_seq;
+	survey_step = 0;
+	survey_running = true;
+
+	AT_PRINTF("+EVT:SURVEY START %d", survey_seq);
+	MYLOG("SURV", "New cell, start burst %d on %d data rates", survey_seq, g_mapper_settings.survey_dr_count);
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.printf("New cell, start survey burst %d\n", survey_seq);
+	}
+	survey_next();
+	return true;
+}
+
+/**
+ * @brief Check if a burst is running
+ *
+ * @return true burst is running
+ */
+bool survey_active(void)
+{
+	return survey_running;
+}
+
+/**
+ * @brief Send the next uplink of the burst
+ *
+ */
+void survey_next(void)
+{
+	if (!survey_running || (survey_step >= g_mapper_settings.survey_dr_count))
+	{
+		return;
+	}
+
+	if (lora_busy)
+	{
+		// Another TX cycle is running, try again later
+		survey_timer.setPeriod(SURVEY_MIN_GAP);
+		survey_timer.start();
+		return;
+	}
+
+	uint8_t dr = g_mapper_settings.survey_drs[survey_step];
+	survey_values.dr = dr;
+	uint8_t len = payload_survey::encode(survey_payload, survey_values);
+
+	MYLOG("SURV", "Burst %d uplink on DR%d", survey_seq, dr);
+	if (lmh_datarate_set(dr, false) != LMH_SUCCESS)
+	{
+		MYLOG("SURV", "DR%d not available", dr);
+		survey_step++;
+		survey_toa = 0;
+		survey_tx_finished();
+		return;
+	}
+
+	survey_tx_start = millis();
+	survey_toa = lora_airtime(dr, len);
+	send_payload(survey_payload, len, payload_survey::fport);
+	survey_step++;
+	if (!lora_busy)
+	{
+		// Not enqueued, e.g. payload too long for the dwell time limit of this DR
+		survey_toa = 0;
+		survey_tx_finished();
+	}
+}
+
+/**
+ * @brief TX cycle of a burst uplink finished, schedule the next one.
+ *        The next uplink starts after the time on air times 99 for a
+ *        1% duty cycle, but not before the configured gap.
+ *
+ */
+void survey_tx_finished(void)
+{
+	if (!survey_running)
+	{
+		return;
+	}
+
+	if (survey_step >= g_mapper_settings.survey_dr_count)
+	{
+		survey_stop();
+		AT_PRINTF("+EVT:SURVEY DONE %d", survey_seq);
+		MYLOG("SURV", "Burst %d finished", survey_seq);
+		return;
+	}
+
+	uint32_t gap = lora_duty_limited() ? survey_toa * 99 : survey_toa;
+	gap = gap < (uint32_t)g_mapper_settings.survey_gap * 1000 ? (uint32_t)g_mapper_settings.survey_gap * 1000 : gap;
+	gap = gap < SURVEY_MIN_GAP ? SURVEY_MIN_GAP : gap;
+
+	uint32_t elapsed = millis() - survey_tx_start;
+	uint32_t wait_time = elapsed + 1000 < gap ? gap - elapsed : 1000;
+	MYLOG("SURV", "Next uplink in %lds", (long)(wait_time / 1000));
+	survey_timer.setPeriod(wait_time);
+	survey_timer.start();
+}
+
+/**
+ * @brief Handle a survey downlink on SURVEY_FPORT
+ *
+ * @param data downlink payload
+ * @param len payload length
+ * @return true valid command
+ * @return false unknown command, too many or invalid data rates
+ */
+bool survey_downlink(uint8_t *data, uint16_t len)
+{
+	if (len == 0)
+	{
+		return false;
+	}
+
+	switch (data[0])
+	{
+	case SURVEY_CMD_STOP:
+		if (survey_active())
+		{
+			survey_stop();
+		}
+		g_mapper_settings.survey_enable = 0;
+		break;
+	case SURVEY_CMD_START:
+		if (len - 1 > SURVEY_MAX_DR)
+		{
+			return false;
+		}
+		for (uint16_t idx = 1; idx < len; idx++)
+		{
+			if (data[idx] > 15)
+			{
+				return false;
+			}
+		}
+		if (len > 1)
+		{
+			memcpy(g_mapper_settings.survey_drs, &data[1], len - 1);
+			g_mapper_settings.survey_dr_count = len - 1;
+		}
+		g_mapper_settings.survey_enable = 1;
+		// Start with a burst at the next fix
+		survey_cell.lat_q = INT32_MAX;
+		break;
+	default:
+		return false;
+	}
+	save_mapper_settings();
+	AT_PRINTF("+EVT:SURVEY %s", g_mapper_settings.survey_enable ? "ON" : "OFF");
+	return true;
+}
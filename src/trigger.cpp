@@ -0,0 +1,228 @@
+/**
+ * @file trigger.cpp
+ * @author agent (agent@local)
+ * @brief Distance and heading based send trigger. While the device moves,
+ *        GNSS is polled in short intervals and an uplink is sent when the
+ *        travelled distance or the change of heading since the last
+ *        uplink is above the limit, as far as the duty cycle allows.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include "geo.h"
+
+/** Shortest segment in mm that counts for distance and heading, filters GNSS jitter */
+#define TRIGGER_MIN_SEGMENT 10000
+
+/** A fix of the tracker is reused by the STATUS event if it is not older than this (ms) */
+#define TRIGGER_FIX_MAX_AGE 5000
+
+/** Timer for the GNSS polls while moving */
+SoftwareTimer track_timer;
+
+/** Position of the last uplink */
+static gnss_fix_s anchor_fix;
+
+/** Flag if anchor_fix is valid */
+static bool anchor_valid = false;
+
+/** Heading at the last uplink in 0.01 degrees */
+static uint16_t anchor_bearing = 0;
+
+/** Flag if anchor_bearing is valid */
+static bool anchor_bearing_valid = false;
+
+/** End of the last counted segment */
+static gnss_fix_s track_prev;
+
+/** Current heading in 0.01 degrees */
+static uint16_t track_bearing = 0;
+
+/** Flag if track_bearing is valid */
+static bool track_bearing_valid = false;
+
+/** Distance travelled since the last uplink in mm */
+static uint32_t path_mm = 0;
+
+/** Last tracker fix, kept apart from the fix of the STATUS event */
+static gnss_fix_s track_fix;
+
+/** Time of the last tracker fix */
+static time_t fresh_fix_time = 0;
+
+/** Flag if the last tracker fix was not used yet */
+static bool fresh_fix = false;
+
+/** Flag if the tracker started the pending STATUS event */
+static bool fired = false;
+
+/**
+ * @brief Timer callback, wake the loop for the next GNSS poll
+ *
+ * @param unused
+ */
+static void track_timer_cb(TimerHandle_t unused)
+{
+	g_task_event_type |= TRACK_TRIGGER;
+	xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Start or stop the tracker after a settings change
+ *
+ */
+void trigger_restart(void)
+{
+	track_timer.stop();
+	if (g_mapper_settings.trigger_mode)
+	{
+		track_timer.setPeriod((uint32_t)g_mapper_settings.trigger_poll * 1000);
+		track_timer.start();
+	}
+}
+
+/**
+ * @brief Initialize the tracker timer
+ *
+ */
+void init_trigger(void)
+{
+	track_timer.begin((uint32_t)g_mapper_settings.trigger_poll * 1000, track_timer_cb, NULL, true);
+	trigger_restart();
+}
+
+/**
+ * @brief Set the reference for distance and heading, called for each fix of a STATUS event
+ *
+ * @param fix position of the uplink
+ */
+void trigger_anchor(gnss_fix_s &fix)
+{
+	anchor_fix = fix;
+	anchor_valid = true;
+	anchor_bearing = track_bearing;
+	anchor_bearing_valid = track_bearing_valid;
+	track_prev = fix;
+	path_mm = 0;
+}
+
+/**
+ * @brief Take the last tracker fix if it is recent, saves a GNSS poll
+ *
+ * @param fix filled with the tracker fix if it is recent
+ * @return true fix is a recent fix
+ */
+bool trigger_take_fix(gnss_fix_s &fix)
+{
+	bool recent = fresh_fix && ((millis() - fresh_fix_time) < TRIGGER_FIX_MAX_AGE);
+	fresh_fix = false;
+	if (recent)
+	{
+		fix = track_fix;
+	}
+	return recent;
+}
+
+/**
+ * @brief Check if the tracker started the STATUS event, clears the flag.
+ *        A triggered STATUS event always sends a new position.
+ *
+ * @return true STATUS event was started by distance or heading
+ */
+bool trigger_fired(void)
+{
+	bool result = fired;
+	fired = false;
+	return result;
+}
+
+/**
+ * @brief Shortest time between two triggered uplinks. The limit per hour,
+ *        the minimum delay of the application and the 1% duty cycle for
+ *        the current DR are applied.
+ *
+ * @return uint32_t spacing in ms
+ */
+static uint32_t trigger_spacing(void)
+{
+	uint32_t spacing = 3600000 / (g_mapper_settings.trigger_max_hour == 0 ? 1 : g_mapper_settings.trigger_max_hour);
+	spacing = spacing < (uint32_t)min_delay ? (uint32_t)min_delay : spacing;
+	if (lora_duty_limited())
+	{
+		uint32_t duty = lora_airtime(lora_current_dr(), payload_v2::size) * 99;
+		spacing = spacing < duty ? duty : spacing;
+	}
+	return spacing;
+}
+
+/**
+ * @brief Poll GNSS while moving and start an uplink if distance or heading changed enough
+ *
+ */
+void trigger_track(void)
+{
+	if (!g_mapper_settings.trigger_mode)
+	{
+		return;
+	}
+
+	// INT1 is latched until read. Without INT2 the parked state comes from the
+	// time of the last INT1, re-arm it on every tick so it follows the motion.
+	bool parked = acc_is_parked();
+	clear_acc_int();
+	if (parked || lora_busy || survey_active())
+	{
+		return;
+	}
+
+	if (!poll_gnss(gnss_option, track_fix))
+	{
+		return;
+	}
+	fresh_fix_time = millis();
+	fresh_fix = true;
+
+	if (!anchor_valid)
+	{
+		// The next STATUS event sets the reference
+		return;
+	}
+
+	uint32_t dist_mm;
+	uint16_t bearing;
+	geo_delta(track_prev.lat_e7, track_prev.lon_e7, track_fix.lat_e7, track_fix.lon_e7, dist_mm, bearing);
+	if (dist_mm >= TRIGGER_MIN_SEGMENT)
+	{
+		path_mm = path_mm + dist_mm < path_mm ? UINT32_MAX : path_mm + dist_mm;
+		track_bearing = bearing;
+		track_bearing_valid = true;
+		track_prev = track_fix;
+	}
+
+	bool by_distance = path_mm >= (uint32_t)g_mapper_settings.trigger_dist * 1000;
+	bool by_heading = anchor_bearing_valid && track_bearing_valid &&
+					  (geo_bearing_diff(anchor_bearing, track_bearing) >= (uint16_t)g_mapper_settings.trigger_heading * 100);
+	if (!by_distance && !by_heading)
+	{
+		return;
+	}
+
+	if ((uint32_t)(millis() - last_pos_send) < trigger_spacing())
+	{
+		MYLOG("TRIG", "Trigger waits for the duty cycle budget");
+		return;
+	}
+
+	AT_PRINTF("+EVT:TRIGGER %s", by_distance ? "DISTANCE" : "HEADING");
+	MYLOG("TRIG", "Moved %ld m, heading %d, send position", (long)(path_mm / 1000), track_bearing / 100);
+	if (g_ble_uart_is_connected)
+	{
+		g_ble_uart.printf("Moved %ld m, heading %d, send position\n", (long)(path_mm / 1000), track_bearing / 100);
+	}
+	last_pos_send = millis();
+	fired = true;
+	g_task_event_type |= STATUS;
+}
@@ -0,0 +1,577 @@
+/**
+ * @file user_at.cpp
+ * @author agent (agent@local)
+ * @brief Application specific AT commands
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+
+/**
+ * @brief Query the RAM headroom
+ *        Prints +MEM:<task>:<free stack> for every task, then
+ *        returns free heap:lowest free heap:free loop task stack in bytes
+ *
+ * @return int AT_OK
+ */
+static int at_query_mem(void)
+{
+	mem_print_tasks();
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%ld:%ld:%ld", (long)mem_heap_free(), (long)mem_heap_min_free(), (long)mem_stack_free());
+	return AT_OK;
+}
+
+/**
+ * @brief Query the stationary handling
+ *        Returns mode:cache time in seconds
+ *
+ * @return int AT_OK
+ */
+static int at_query_still(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld", g_mapper_settings.still_mode, (long)g_mapper_settings.fix_cache_time);
+	return AT_OK;
+}
+
+/**
+ * @brief Set the stationary handling
+ *        AT+STILL=<mode>:<cache time in seconds, 1 to 86400>
+ *        mode 0 = always poll GNSS, 1 = send heartbeat with cached fix, 2 = skip uplink
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_still(char *str)
+{
+	char *param = strtok(str, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	long mode = strtol(param, NULL, 0);
+	if ((mode < STILL_POLL) || (mode > STILL_SKIP))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+
+	long cache_time = g_mapper_settings.fix_cache_time;
+	param = strtok(NULL, ":");
+	if (param != NULL)
+	{
+		cache_time = strtol(param, NULL, 0);
+		if ((cache_time <= 0) || (cache_time > STILL_MAX_CACHE_TIME))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+	}
+
+	g_mapper_settings.still_mode = (uint8_t)mode;
+	g_mapper_settings.fix_cache_time = (uint32_t)cache_time;
+	save_mapper_settings();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the accelerometer wakeup state
+ *        Returns threshold:duration:noise floor:parked:allowed false wakeups per hour
+ *
+ * @return int AT_OK
+ */
+static int at_query_acc(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%d:%d:%d", acc_ths, acc_duration, acc_noise,
+			 acc_is_parked() ? 1 : 0, g_mapper_settings.acc_false_wakes);
+	return AT_OK;
+}
+
+/**
+ * @brief Set the allowed wakeups per hour without movement
+ *        AT+ACC=<false wakeups per hour>
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_acc(char *str)
+{
+	long false_wakes = strtol(str, NULL, 0);
+	if ((false_wakes < 0) || (false_wakes > 3600))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_mapper_settings.acc_false_wakes = (uint16_t)false_wakes;
+	save_mapper_settings();
+	return AT_OK;
+}
+
+/**
+ * @brief Measure the accelerometer noise floor again
+ *        The device must not move during the 3 seconds of measurement
+ *
+ * @return int AT_OK
+ */
+static int at_exec_acc_cal(void)
+{
+	acc_calibrate();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the coverage aware sampling
+ *        Returns send every Nth fix in covered cells:filter bits set
+ *
+ * @return int AT_OK
+ */
+static int at_query_cover(void)
+{
+	uint32_t bits_set = 0;
+	for (uint16_t idx = 0; idx < sizeof(g_coverage.data); idx++)
+	{
+		for (uint8_t bit = g_coverage.data[idx]; bit != 0; bit &= bit - 1)
+		{
+			bits_set++;
+		}
+	}
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%ld", g_mapper_settings.cover_every, (long)bits_set);
+	return AT_OK;
+}
+
+/**
+ * @brief Set how often fixes in covered cells are sent
+ *        AT+COVER=<N>, send every Nth fix, 0 = send all
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_cover(char *str)
+{
+	long every = strtol(str, NULL, 0);
+	if ((every < 0) || (every > 65535))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_mapper_settings.cover_every = (uint16_t)every;
+	save_mapper_settings();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the distance and heading trigger
+ *        Returns enable:distance m:heading deg:poll s:max per hour
+ *
+ * @return int AT_OK
+ */
+static int at_query_trigger(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%d:%d:%d", g_mapper_settings.trigger_mode, g_mapper_settings.trigger_dist,
+			 g_mapper_settings.trigger_heading, g_mapper_settings.trigger_poll, g_mapper_settings.trigger_max_hour);
+	return AT_OK;
+}
+
+/**
+ * @brief Set the distance and heading trigger
+ *        AT+TRIG=<enable>:<distance m>:<heading deg>:<poll s>:<max per hour>, trailing values are optional
+ *
+ * @param str parameters
+ * @return int AT_OK or error
+ */
+static int at_exec_trigger(char *str)
+{
+	long values[5] = {g_mapper_settings.trigger_mode, g_mapper_settings.trigger_dist, g_mapper_settings.trigger_heading,
+					  g_mapper_settings.trigger_poll, g_mapper_settings.trigger_max_hour};
+	static const long min_values[5] = {0, 10, 5, 1, 1};
+	static const long max_values[5] = {1, 65535, 180, 255, 255};
+	uint8_t count = 0;
+	for (char *param = strtok(str, ":"); param != NULL; param = strtok(NULL, ":"))
+	{
+		if (count == 5)
+		{
+			return AT_ERRNO_PARA_NUM;
+		}
+		values[count] = strtol(param, NULL, 0);
+		if ((values[count] < min_values[count]) || (values[count] > max_values[count]))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		count++;
+	}
+	if (count == 0)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	g_mapper_settings.trigger_mode = (uint8_t)values[0];
+	g_mapper_settings.trigger_dist = (uint16_t)values[1];
+	g_mapper_settings.trigger_heading = (uint8_t)values[2];
+	g_mapper_settings.trigger_poll = (uint8_t)values[3];
+	g_mapper_settings.trigger_max_hour = (uint8_t)values[4];
+	save_mapper_settings();
+	trigger_restart();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the GNSS profile
+ *        Returns setting, 3 = auto:name of the active profile
+ *
+ * @return int AT_OK
+ */
+static int at_query_gnss_profile(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%s", g_mapper_settings.gnss_profile, gnss_profile().name);
+	return AT_OK;
+}
+
+/**
+ * @brief Set the GNSS profile
+ *        AT+GNSSP=<0 = stationary, 1 = pedestrian, 2 = automotive, 3 = auto>
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_gnss_profile(char *str)
+{
+	long profile = strtol(str, NULL, 0);
+	if ((profile < 0) || (profile > GNSS_PROFILE_AUTO))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_mapper_settings.gnss_profile = (uint8_t)profile;
+	save_mapper_settings();
+	gnss_profile_restart();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the battery model
+ *        Returns policy enable:filtered mV:state of charge %:runtime minutes, -1 = unknown:interval factor
+ *
+ * @return int AT_OK
+ */
+static int at_query_batt(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d:%d.%d:%ld:%d", g_mapper_settings.batt_policy, batt_level,
+			 batt_soc_pm() / 10, batt_soc_pm() % 10, (long)batt_runtime_min(), batt_interval_factor());
+	return AT_OK;
+}
+
+/**
+ * @brief Enable or disable the battery policy
+ *        AT+BATT=<0|1>
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_batt(char *str)
+{
+	long enable = strtol(str, NULL, 0);
+	if ((enable < 0) || (enable > 1))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	g_mapper_settings.batt_policy = (uint8_t)enable;
+	save_mapper_settings();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the link quality feedback
+ *        Returns enable:SNR margin dB:RSSI:ACK rate %:interval factor
+ *
+ * @return int AT_OK
+ */
+static int at_query_link(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%.1f:%d:%d:%d", g_mapper_settings.link_adapt, link_margin_q4() / 16.0,
+			 link_rssi(), link_ack_percent(), link_interval_factor());
+	return AT_OK;
+}
+
+/**
+ * @brief Enable or disable the link quality feedback
+ *        AT+LINK=<0|1>
+ *
+ * @param str parameters
+ * @return int AT_OK or AT_ERRNO_PARA_VAL
+ */
+static int at_exec_link(char *str)
+{
+	long enable = strtol(str, NULL, 0);
+	if ((enable < 0) || (enable > 1))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (!enable)
+	{
+		link_reset();
+	}
+	g_mapper_settings.link_adapt = (uint8_t)enable;
+	save_mapper_settings();
+	return AT_OK;
+}
+
+/**
+ * @brief Query the survey mode
+ *        Returns enable:gap:dr1:dr2:...
+ *
+ * @return int AT_OK
+ */
+static int at_query_survey(void)
+{
+	int len = snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d", g_mapper_settings.survey_enable, g_mapper_settings.survey_gap);
+	for (uint8_t idx = 0; idx < g_mapper_settings.survey_dr_count; idx++)
+	{
+		len += snprintf(&g_at_query_buf[len], ATQUERY_SIZE - len, ":%d", g_mapper_settings.survey_drs[idx]);
+	}
+	return AT_OK;
+}
+
+/**
+ * @brief Set the survey mode
+ *        AT+SURVEY=<enable>:<gap s>:<dr1>:<dr2>:..., the data rate list is optional
+ *
+ * @param str parameters
+ * @return int AT_OK or error
+ */
+static int at_exec_survey(char *str)
+{
+	char *param = strtok(str, ":");
+	if (param == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	long enable = strtol(param, NULL, 0);
+	param = strtok(NULL, ":");
+	long gap = param != NULL ? strtol(param, NULL, 0) : g_mapper_settings.survey_gap;
+	if ((enable < 0) || (enable > 1) || (gap < 0) || (gap > 3600))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+
+	uint8_t drs[SURVEY_MAX_DR];
+	uint8_t dr_count = 0;
+	for (param = strtok(NULL, ":"); param != NULL; param = strtok(NULL, ":"))
+	{
+		long dr = strtol(param, NULL, 0);
+		if ((dr_count == SURVEY_MAX_DR) || (dr < 0) || (dr > 15))
+		{
+			return AT_ERRNO_PARA_VAL;
+		}
+		drs[dr_count++] = (uint8_t)dr;
+	}
+
+	// Reuse the downlink command, it handles a running burst
+	uint8_t cmd[SURVEY_MAX_DR + 1];
+	cmd[0] = enable ? SURVEY_CMD_START : SURVEY_CMD_STOP;
+	memcpy(&cmd[1], drs, dr_count);
+	uint16_t old_gap = g_mapper_settings.survey_gap;
+	g_mapper_settings.survey_gap = (uint16_t)gap;
+	if (!survey_downlink(cmd, enable ? dr_count + 1 : 1))
+	{
+		g_mapper_settings.survey_gap = old_gap;
+		return AT_ERRNO_PARA_VAL;
+	}
+	return AT_OK;
+}
+
+/** Vertices per AT+ZONEP or AT+ZONEV command, longer outlines are continued with AT+ZONEV */
+#define ZONE_AT_POINTS 16
+
+/**
+ * @brief Parse a lat:lon pair in degrees
+ *
+ * @param lat latitude token
+ * @param lon longitude token
+ * @param point parsed position in 1e-7 degrees
+ * @return true position parsed
+ * @return false token missing or outside +/-90 latitude, +/-180 longitude
+ */
+static bool parse_point(const char *lat, const char *lon, zone_vertex_s &point)
+{
+	if ((lat == NULL) || (lon == NULL))
+	{
+		return false;
+	}
+	double lat_deg = strtod(lat, NULL);
+	double lon_deg = strtod(lon, NULL);
+	if (!(lat_deg >= -90.0 && lat_deg <= 90.0) || !(lon_deg >= -180.0 && lon_deg <= 180.0))
+	{
+		return false;
+	}
+	point.lat_e7 = (int32_t)(lat_deg * 1e7);
+	point.lon_e7 = (int32_t)(lon_deg * 1e7);
+	return true;
+}
+
+/**
+ * @brief Parse lat:lon pairs in degrees, continues a strtok() on the parameters
+ *
+ * @param param first latitude token
+ * @param points parsed vertices
+ * @param max_points size of points
+ * @return int number of vertices, -1 on a missing longitude, a position
+ *         out of range or more than max_points pairs
+ */
+static int parse_points(char *param, zone_vertex_s *points, int max_points)
+{
+	int count = 0;
+	while (param != NULL)
+	{
+		if (count >= max_points)
+		{
+			return -1;
+		}
+		if (!parse_point(param, strtok(NULL, ":"), points[count]))
+		{
+			return -1;
+		}
+		count++;
+		param = strtok(NULL, ":");
+	}
+	return count;
+}
+
+/**
+ * @brief Query the exclusion zones
+ *        Returns zones:vertices used
+ *
+ * @return int AT_OK
+ */
+static int at_query_zone(void)
+{
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d:%d", g_zones.zone_count, g_zones.vertex_count);
+	return AT_OK;
+}
+
+/**
+ * @brief Add a circle exclusion zone
+ *        AT+ZONEC=<mode>:<lat>:<lon>:<radius m>, mode 0 = suppress, 1 = reduce precision
+ *
+ * @param str parameters
+ * @return int AT_OK or error
+ */
+static int at_exec_zone_circle(char *str)
+{
+	char *mode = strtok(str, ":");
+	char *lat = strtok(NULL, ":");
+	char *lon = strtok(NULL, ":");
+	char *radius = strtok(NULL, ":");
+	if (radius == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	long zone_mode = strtol(mode, NULL, 0);
+	long radius_m = strtol(radius, NULL, 0);
+	zone_vertex_s center;
+	if ((zone_mode < ZONE_SUPPRESS) || (zone_mode > ZONE_REDUCE) || (radius_m <= 0) || !parse_point(lat, lon, center))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (g_zones.add_circle((uint8_t)zone_mode, center.lat_e7, center.lon_e7, (uint32_t)radius_m) < 0)
+	{
+		return AT_ERRNO_EXEC_FAIL;
+	}
+	g_zones.build();
+	return AT_OK;
+}
+
+/**
+ * @brief Add a polygon exclusion zone
+ *        AT+ZONEP=<mode>:<lat1>:<lon1>:<lat2>:<lon2>:..., up to ZONE_AT_POINTS vertices
+ *
+ * @param str parameters
+ * @return int AT_OK or error
+ */
+static int at_exec_zone_polygon(char *str)
+{
+	zone_vertex_s points[ZONE_AT_POINTS];
+	char *mode = strtok(str, ":");
+	if (mode == NULL)
+	{
+		return AT_ERRNO_PARA_NUM;
+	}
+	long zone_mode = strtol(mode, NULL, 0);
+	int count = parse_points(strtok(NULL, ":"), points, ZONE_AT_POINTS);
+	if ((zone_mode < ZONE_SUPPRESS) || (zone_mode > ZONE_REDUCE) || (count < 1))
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (g_zones.add_polygon((uint8_t)zone_mode, points, (uint16_t)count) < 0)
+	{
+		return AT_ERRNO_EXEC_FAIL;
+	}
+	g_zones.build();
+	return AT_OK;
+}
+
+/**
+ * @brief Append vertices to the last polygon
+ *        AT+ZONEV=<lat1>:<lon1>:<lat2>:<lon2>:..., up to ZONE_AT_POINTS vertices
+ *
+ * @param str parameters
+ * @return int AT_OK or error
+ */
+static int at_exec_zone_vertices(char *str)
+{
+	zone_vertex_s points[ZONE_AT_POINTS];
+	int count = parse_points(strtok(str, ":"), points, ZONE_AT_POINTS);
+	if (count < 1)
+	{
+		return AT_ERRNO_PARA_VAL;
+	}
+	if (!g_zones.add_vertices(points, (uint16_t)count))
+	{
+		return AT_ERRNO_EXEC_FAIL;
+	}
+	g_zones.build();
+	return AT_OK;
+}
+
+/**
+ * @brief Save the exclusion zones to flash
+ *
+ * @return int AT_OK or AT_ERRNO_EXEC_FAIL
+ */
+static int at_exec_zone_save(void)
+{
+	return save_zones() ? AT_OK : AT_ERRNO_EXEC_FAIL;
+}
+
+/**
+ * @brief Delete all exclusion zones
+ *
+ * @return int AT_OK or AT_ERRNO_EXEC_FAIL
+ */
+static int at_exec_zone_delete(void)
+{
+	g_zones.clear();
+	return save_zones() ? AT_OK : AT_ERRNO_EXEC_FAIL;
+}
+
+/** Application AT commands */
+atcmd_t g_user_at_cmd_list_mapper[] = {
+	/*|    CMD    |     AT+CMD?      |    AT+CMD=?    |  AT+CMD=value |  AT+CMD  | Permissions |*/
+	{"+ACC", "Get threshold:duration:noise:parked:max false wakes, set max false wakeups per hour", at_query_acc, at_exec_acc, NULL, "RW"},
+	{"+ACCCAL", "Calibrate the accelerometer wakeup threshold, device must be at rest", NULL, NULL, at_exec_acc_cal, "W"},
+	{"+COVER", "Set/Get send every Nth fix in covered cells, 0 = all:filter bits set", at_query_cover, at_exec_cover, NULL, "RW"},
+	{"+TRIG", "Set/Get distance trigger enable:distance m:heading deg:poll s:max uplinks per hour", at_query_trigger, at_exec_trigger, NULL, "RW"},
+	{"+GNSSP", "Set/Get GNSS profile 0 = stationary, 1 = pedestrian, 2 = automotive, 3 = auto:active profile", at_query_gnss_profile, at_exec_gnss_profile, NULL, "RW"},
+	{"+BATT", "Set/Get battery policy enable:mV:charge %:runtime min:interval factor", at_query_batt, at_exec_batt, NULL, "RW"},
+	{"+LINK", "Set/Get link feedback enable:SNR margin:RSSI:ACK rate %:interval factor", at_query_link, at_exec_link, NULL, "RW"},
+	{"+SURVEY", "Set/Get survey burst enable:gap seconds:dr1:dr2:..., one uplink per DR in each new cell", at_query_survey, at_exec_survey, NULL, "RW"},
+	{"+ZONE", "Get number of exclusion zones:vertices used", at_query_zone, NULL, NULL, "R"},
+	{"+ZONEC", "Add circle zone mode:lat:lon:radius, mode 0 = suppress, 1 = reduce precision", NULL, at_exec_zone_circle, NULL, "W"},
+	{"+ZONEP", "Add polygon zone mode:lat1:lon1:lat2:lon2:..., mode 0 = suppress, 1 = reduce precision", NULL, at_exec_zone_polygon, NULL, "W"},
+	{"+ZONEV", "Add vertices lat1:lon1:... to the last polygon zone", NULL, at_exec_zone_vertices, NULL, "W"},
+	{"+ZONESAVE", "Save the exclusion zones to flash", NULL, NULL, at_exec_zone_save, "W"},
+	{"+ZONEDEL", "Delete all exclusion zones", NULL, NULL, at_exec_zone_delete, "W"},
+	{"+MEM", "Get free heap:lowest free heap:free loop task stack in bytes, prints free stack of all tasks", at_query_mem, NULL, NULL, "R"},
+	{"+STILL", "Set/Get stationary handling mode:cache time, mode 0 = poll GNSS, 1 = heartbeat, 2 = skip", at_query_still, at_exec_still, NULL, "RW"},
+};
+
+/** Pointer to the application AT commands */
+atcmd_t *g_user_at_cmd_list = g_user_at_cmd_list_mapper;
+
+/** Number of application AT commands */
+uint8_t g_user_at_cmd_num = sizeof(g_user_at_cmd_list_mapper) / sizeof(atcmd_t);
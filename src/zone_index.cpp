@@ -0,0 +1,394 @@
+/**
+ * @file zone_index.cpp
+ * @author agent (agent@local)
+ * @brief Bounding boxes, grid index build and the point in
+ *        circle/polygon tests of the exclusion zones.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "zone_index.h"
+#include <math.h>
+
+/** Meters per 1e-7 degree of latitude */
+#define ZONE_M_PER_E7 0.011131949f
+/** 180 degrees in 1e-7 degrees */
+#define ZONE_LON_MAX_E7 1800000000
+/** Number of grid cells around the earth */
+#define ZONE_LON_CELLS (2 * (ZONE_LON_MAX_E7 / ZONE_GRID_E7))
+
+/**
+ * @brief Grid coordinate, rounds towards negative infinity
+ */
+static inline int32_t zone_grid(int32_t value_e7)
+{
+	return value_e7 >= 0 ? value_e7 / ZONE_GRID_E7 : -((-value_e7 + ZONE_GRID_E7 - 1) / ZONE_GRID_E7);
+}
+
+/**
+ * @brief Longitude grid coordinate folded into -180 ... <180 degrees,
+ *        a zone crossing the 180th meridian counts its cells beyond it
+ */
+static inline int32_t zone_grid_lon(int32_t lon_q)
+{
+	return lon_q >= ZONE_LON_CELLS / 2 ? lon_q - ZONE_LON_CELLS : lon_q;
+}
+
+/**
+ * @brief Longitude of a zone crossing the 180th meridian continued
+ *        east beyond 180 degrees, unchanged for other zones
+ */
+static inline int64_t zone_lon(int32_t lon_e7, bool wraps)
+{
+	return wraps && (lon_e7 < 0) ? (int64_t)lon_e7 + 2 * (int64_t)ZONE_LON_MAX_E7 : (int64_t)lon_e7;
+}
+
+/**
+ * @brief Zone crosses the 180th meridian
+ */
+static inline bool zone_wraps(const zone_s &zone)
+{
+	return zone.lon_min > zone.lon_max;
+}
+
+/**
+ * @brief Hash bucket of a grid cell
+ */
+static inline uint16_t zone_bucket(int32_t lat_q, int32_t lon_q)
+{
+	uint32_t hash = ((uint32_t)lat_q * 73856093u) ^ ((uint32_t)lon_q * 19349663u);
+	return (uint16_t)(hash % ZONE_BUCKETS);
+}
+
+/**
+ * @brief Cosine of a latitude
+ */
+static inline float zone_cos_lat(int32_t lat_e7)
+{
+	return cosf((float)lat_e7 * (float)(M_PI / 180.0 / 1e7));
+}
+
+/**
+ * @brief Remove all zones
+ *
+ */
+void zone_index::clear(void)
+{
+	zone_count = 0;
+	vertex_count = 0;
+	large_count = 0;
+	index_valid = false;
+}
+
+/**
+ * @brief Add a circle
+ *
+ * @param mode ZONE_SUPPRESS or ZONE_REDUCE
+ * @param lat_e7 center latitude in 1e-7 degrees
+ * @param lon_e7 center longitude in 1e-7 degrees
+ * @param radius_m radius in meters
+ * @return int zone id or -1 if there is no space left
+ */
+int zone_index::add_circle(uint8_t mode, int32_t lat_e7, int32_t lon_e7, uint32_t radius_m)
+{
+	if ((zone_count >= ZONE_MAX) || (vertex_count >= ZONE_MAX_VERTICES))
+	{
+		return -1;
+	}
+	zone_s &zone = zones[zone_count];
+	zone.type = ZONE_CIRCLE;
+	zone.mode = mode;
+	zone.first_vertex = vertex_count;
+	zone.vertex_count = 1;
+	zone.radius_m = radius_m;
+	vertices[vertex_count].lat_e7 = lat_e7;
+	vertices[vertex_count].lon_e7 = lon_e7;
+	vertex_count++;
+	update_bbox(zone);
+	index_valid = false;
+	return zone_count++;
+}
+
+/**
+ * @brief Add a polygon, more vertices can be appended with add_vertices()
+ *
+ * @param mode ZONE_SUPPRESS or ZONE_REDUCE
+ * @param points vertices
+ * @param count number of vertices
+ * @return int zone id or -1 if there is no space left
+ */
+int zone_index::add_polygon(uint8_t mode, const zone_vertex_s *points, uint16_t count)
+{
+	if ((zone_count >= ZONE_MAX) || (vertex_count + count > ZONE_MAX_VERTICES) || (count == 0))
+	{
+		return -1;
+	}
+	zone_s &zone = zones[zone_count];
+	zone.type = ZONE_POLYGON;
+	zone.mode = mode;
+	zone.first_vertex = vertex_count;
+	zone.vertex_count = 0;
+	zone.radius_m = 0;
+	zone_count++;
+	if (!add_vertices(points, count))
+	{
+		zone_count--;
+		return -1;
+	}
+	return zone_count - 1;
+}
+
+/**
+ * @brief Append vertices to the last added polygon
+ *
+ * @param points vertices
+ * @param count number of vertices
+ * @return true vertices added
+ * @return false last zone is not a polygon or no space left
+ */
+bool zone_index::add_vertices(const zone_vertex_s *points, uint16_t count)
+{
+	if ((zone_count == 0) || (zones[zone_count - 1].type != ZONE_POLYGON) || (vertex_count + count > ZONE_MAX_VERTICES))
+	{
+		return false;
+	}
+	zone_s &zone = zones[zone_count - 1];
+	for (uint16_t idx = 0; idx < count; idx++)
+	{
+		vertices[vertex_count++] = points[idx];
+	}
+	zone.vertex_count += count;
+	update_bbox(zone);
+	index_valid = false;
+	return true;
+}
+
+/**
+ * @brief Recalculate the bounding box of a zone
+ */
+void zone_index::update_bbox(zone_s &zone)
+{
+	const zone_vertex_s *first = &vertices[zone.first_vertex];
+	if (zone.type == ZONE_CIRCLE)
+	{
+		int32_t dlat = (int32_t)(zone.radius_m / ZONE_M_PER_E7) + 1;
+		float cos_lat = zone_cos_lat(first->lat_e7);
+		int64_t dlon = cos_lat > 0.01f ? (int64_t)(dlat / cos_lat) + 1 : ZONE_LON_MAX_E7;
+		int64_t lon_min = (int64_t)first->lon_e7 - dlon;
+		int64_t lon_max = (int64_t)first->lon_e7 + dlon;
+		zone.lat_min = first->lat_e7 - dlat;
+		zone.lat_max = first->lat_e7 + dlat;
+		if ((lon_min < -ZONE_LON_MAX_E7) && (lon_max > ZONE_LON_MAX_E7))
+		{
+			// Close to a pole, all longitudes
+			lon_min = -ZONE_LON_MAX_E7;
+			lon_max = ZONE_LON_MAX_E7;
+		}
+		else if (lon_min < -ZONE_LON_MAX_E7)
+		{
+			lon_min += 2 * (int64_t)ZONE_LON_MAX_E7;
+		}
+		else if (lon_max > ZONE_LON_MAX_E7)
+		{
+			lon_max -= 2 * (int64_t)ZONE_LON_MAX_E7;
+		}
+		zone.lon_min = (int32_t)lon_min;
+		zone.lon_max = (int32_t)lon_max;
+		return;
+	}
+	zone.lat_min = zone.lat_max = first->lat_e7;
+	zone.lon_min = zone.lon_max = first->lon_e7;
+	// Longitude range with the western hemisphere continued beyond 180 degrees
+	int64_t wrap_min = zone_lon(first->lon_e7, true);
+	int64_t wrap_max = wrap_min;
+	for (uint16_t idx = 1; idx < zone.vertex_count; idx++)
+	{
+		const zone_vertex_s &point = first[idx];
+		int64_t wrap_lon = zone_lon(point.lon_e7, true);
+		zone.lat_min = point.lat_e7 < zone.lat_min ? point.lat_e7 : zone.lat_min;
+		zone.lat_max = point.lat_e7 > zone.lat_max ? point.lat_e7 : zone.lat_max;
+		zone.lon_min = point.lon_e7 < zone.lon_min ? point.lon_e7 : zone.lon_min;
+		zone.lon_max = point.lon_e7 > zone.lon_max ? point.lon_e7 : zone.lon_max;
+		wrap_min = wrap_lon < wrap_min ? wrap_lon : wrap_min;
+		wrap_max = wrap_lon > wrap_max ? wrap_lon : wrap_max;
+	}
+	// A zone is never wider than half the earth, the narrower range is the right one
+	if (wrap_max - wrap_min < (int64_t)zone.lon_max - zone.lon_min)
+	{
+		zone.lon_min = (int32_t)wrap_min;
+		zone.lon_max = (int32_t)(wrap_max - 2 * (int64_t)ZONE_LON_MAX_E7);
+	}
+}
+
+/**
+ * @brief Build the grid index. Every zone is entered in the buckets
+ *        of all grid cells its bounding box touches.
+ *
+ * @return true index built
+ * @return false too many entries, find() falls back to checking all zones
+ */
+bool zone_index::build(void)
+{
+	large_count = 0;
+	for (uint16_t bucket = 0; bucket <= ZONE_BUCKETS; bucket++)
+	{
+		bucket_start[bucket] = 0;
+	}
+
+	// First pass counts the entries per bucket, second pass fills them
+	uint32_t total = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (uint16_t id = 0; id < zone_count; id++)
+		{
+			const zone_s &zone = zones[id];
+			int32_t lat_q_min = zone_grid(zone.lat_min);
+			int32_t lat_q_max = zone_grid(zone.lat_max);
+			int32_t lon_q_min = zone_grid(zone.lon_min);
+			int32_t lon_q_max = zone_grid(zone.lon_max) + (zone_wraps(zone) ? ZONE_LON_CELLS : 0);
+			if ((int64_t)(lat_q_max - lat_q_min + 1) * (lon_q_max - lon_q_min + 1) > ZONE_MAX_CELLS)
+			{
+				if (pass == 0)
+				{
+					large[large_count++] = (uint8_t)id;
+				}
+				continue;
+			}
+			for (int32_t lat_q = lat_q_min; lat_q <= lat_q_max; lat_q++)
+			{
+				for (int32_t lon_q = lon_q_min; lon_q <= lon_q_max; lon_q++)
+				{
+					uint16_t bucket = zone_bucket(lat_q, zone_grid_lon(lon_q));
+					if (pass == 0)
+					{
+						bucket_start[bucket]++;
+						total++;
+					}
+					else
+					{
+						entries[--bucket_start[bucket]] = (uint8_t)id;
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			if (total > ZONE_MAX_ENTRIES)
+			{
+				index_valid = false;
+				return false;
+			}
+			// Turn counts into bucket end positions
+			for (uint16_t bucket = 1; bucket < ZONE_BUCKETS; bucket++)
+			{
+				bucket_start[bucket] += bucket_start[bucket - 1];
+			}
+			bucket_start[ZONE_BUCKETS] = (uint16_t)total;
+		}
+	}
+	index_valid = true;
+	return true;
+}
+
+/**
+ * @brief Exact test if a position is inside a zone
+ *
+ * @param zone zone to test
+ * @param lat_e7 latitude in 1e-7 degrees
+ * @param lon_e7 longitude in 1e-7 degrees
+ * @return true position is inside
+ */
+bool zone_index::contains(const zone_s &zone, int32_t lat_e7, int32_t lon_e7) const
+{
+	bool wraps = zone_wraps(zone);
+	if ((lat_e7 < zone.lat_min) || (lat_e7 > zone.lat_max))
+	{
+		return false;
+	}
+	if (wraps ? ((lon_e7 < zone.lon_min) && (lon_e7 > zone.lon_max)) : ((lon_e7 < zone.lon_min) || (lon_e7 > zone.lon_max)))
+	{
+		return false;
+	}
+
+	const zone_vertex_s *first = &vertices[zone.first_vertex];
+	if (zone.type == ZONE_CIRCLE)
+	{
+		// Equirectangular distance, exact enough for zone sized circles
+		int64_t delta_lon = (int64_t)lon_e7 - first->lon_e7;
+		if (delta_lon > ZONE_LON_MAX_E7)
+		{
+			delta_lon -= 2 * (int64_t)ZONE_LON_MAX_E7;
+		}
+		else if (delta_lon < -ZONE_LON_MAX_E7)
+		{
+			delta_lon += 2 * (int64_t)ZONE_LON_MAX_E7;
+		}
+		float dlat = (float)(lat_e7 - first->lat_e7);
+		float dlon = (float)delta_lon * zone_cos_lat(first->lat_e7);
+		float radius = zone.radius_m / ZONE_M_PER_E7;
+		return (dlat * dlat + dlon * dlon) <= radius * radius;
+	}
+
+	// Crossing number test, all in integer
+	bool inside = false;
+	int64_t lon = zone_lon(lon_e7, wraps);
+	for (uint16_t idx = 0, prev = zone.vertex_count - 1; idx < zone.vertex_count; prev = idx++)
+	{
+		const zone_vertex_s &vi = first[idx];
+		const zone_vertex_s &vj = first[prev];
+		if ((vi.lat_e7 > lat_e7) != (vj.lat_e7 > lat_e7))
+		{
+			int64_t vi_lon = zone_lon(vi.lon_e7, wraps);
+			int64_t den = (int64_t)vj.lat_e7 - vi.lat_e7;
+			int64_t num = ((int64_t)lat_e7 - vi.lat_e7) * (zone_lon(vj.lon_e7, wraps) - vi_lon);
+			int64_t lhs = (lon - vi_lon) * den;
+			if (den > 0 ? lhs < num : lhs > num)
+			{
+				inside = !inside;
+			}
+		}
+	}
+	return inside;
+}
+
+/**
+ * @brief Find the zone a position is in
+ *
+ * @param lat_e7 latitude in 1e-7 degrees
+ * @param lon_e7 longitude in 1e-7 degrees
+ * @return int zone id or -1 if the position is in no zone
+ */
+int zone_index::find(int32_t lat_e7, int32_t lon_e7) const
+{
+	if (!index_valid)
+	{
+		for (uint16_t id = 0; id < zone_count; id++)
+		{
+			if (contains(zones[id], lat_e7, lon_e7))
+			{
+				return id;
+			}
+		}
+		return -1;
+	}
+
+	uint16_t bucket = zone_bucket(zone_grid(lat_e7), zone_grid_lon(zone_grid(lon_e7)));
+	for (uint16_t idx = bucket_start[bucket]; idx < bucket_start[bucket + 1]; idx++)
+	{
+		if (contains(zones[entries[idx]], lat_e7, lon_e7))
+		{
+			return entries[idx];
+		}
+	}
+	for (uint16_t idx = 0; idx < large_count; idx++)
+	{
+		if (contains(zones[large[idx]], lat_e7, lon_e7))
+		{
+			return large[idx];
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file zone_index.h
+ * @author agent (agent@local)
+ * @brief Privacy/exclusion zones (circles and polygons) with a
+ *        hashed uniform grid index for constant time lookups.
+ *        tools/zones builds the same index to check it on real outlines.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ZONE_INDEX_H
+#define ZONE_INDEX_H
+
+#include <stdint.h>
+
+/** Maximum number of zones */
+#define ZONE_MAX 256
+/** Maximum number of polygon vertices and circle centers of all zones */
+#define ZONE_MAX_VERTICES 1024
+/** Grid cell size of the index in 1e-7 degrees, 0.01 degrees is about 1.1 km */
+#define ZONE_GRID_E7 100000
+/** Number of hash buckets of the grid */
+#define ZONE_BUCKETS 512
+/** Maximum number of zone entries in all buckets */
+#define ZONE_MAX_ENTRIES 2048
+/** Zones covering more grid cells are kept in a list that is always checked */
+#define ZONE_MAX_CELLS 64
+
+/** Zone types */
+#define ZONE_CIRCLE 1
+#define ZONE_POLYGON 2
+
+/** What to do with a fix inside a zone */
+#define ZONE_SUPPRESS 0 // Do not send the fix
+#define ZONE_REDUCE 1	// Send the fix with reduced precision
+
+/** Polygon vertex or circle center */
+struct zone_vertex_s
+{
+	int32_t lat_e7;
+	int32_t lon_e7;
+};
+
+/** One zone */
+struct zone_s
+{
+	uint8_t type;
+	uint8_t mode;
+	uint16_t first_vertex;
+	uint16_t vertex_count;
+	uint32_t radius_m; // Circle radius in meters
+	int32_t lat_min;   // Bounding box in 1e-7 degrees
+	int32_t lat_max;
+	int32_t lon_min;   // lon_min > lon_max if the zone crosses the 180th meridian
+	int32_t lon_max;
+};
+
+/**
+ * @brief Set of zones with grid index. After zones are added
+ *        build() must be called before find() sees them.
+ */
+class zone_index
+{
+public:
+	void clear(void);
+	int add_circle(uint8_t mode, int32_t lat_e7, int32_t lon_e7, uint32_t radius_m);
+	int add_polygon(uint8_t mode, const zone_vertex_s *points, uint16_t count);
+	bool add_vertices(const zone_vertex_s *points, uint16_t count);
+	bool build(void);
+	int find(int32_t lat_e7, int32_t lon_e7) const;
+	bool contains(const zone_s &zone, int32_t lat_e7, int32_t lon_e7) const;
+
+	zone_s zones[ZONE_MAX];
+	zone_vertex_s vertices[ZONE_MAX_VERTICES];
+	uint16_t zone_count = 0;
+	uint16_t vertex_count = 0;
+
+private:
+	void update_bbox(zone_s &zone);
+
+	/** Start of each bucket in entries, bucket i is entries[bucket_start[i]..bucket_start[i + 1]] */
+	uint16_t bucket_start[ZONE_BUCKETS + 1];
+	/** Zone ids of all buckets */
+	uint8_t entries[ZONE_MAX_ENTRIES];
+	/** Zones too large for the grid */
+	uint8_t large[ZONE_MAX];
+	uint16_t large_count = 0;
+	bool index_valid = false;
+};
+
+#endif
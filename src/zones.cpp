@@ -0,0 +1,156 @@
+/**
+ * @file zones.cpp
+ * @author agent (agent@local)
+ * @brief Privacy/exclusion zones, saved in flash and
+ *        checked for every fix before it is sent
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "app.h"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Exclusion zones */
+zone_index g_zones;
+
+/** Name of the zones file */
+static const char zones_name[] = "ZONES";
+
+/** File to save the zones */
+static File zones_file(InternalFS);
+
+/**
+ * @brief Check the zones read from flash before the index uses them
+ *
+ * @return true every zone references vertices inside the loaded set
+ * @return false file content is corrupt
+ */
+static bool zones_valid(void)
+{
+	for (uint16_t idx = 0; idx < g_zones.vertex_count; idx++)
+	{
+		const zone_vertex_s &point = g_zones.vertices[idx];
+		if ((point.lat_e7 < -900000000) || (point.lat_e7 > 900000000) ||
+			(point.lon_e7 < -1800000000) || (point.lon_e7 > 1800000000))
+		{
+			return false;
+		}
+	}
+	for (uint16_t idx = 0; idx < g_zones.zone_count; idx++)
+	{
+		const zone_s &zone = g_zones.zones[idx];
+		if ((zone.mode > ZONE_REDUCE) || (zone.vertex_count == 0) ||
+			((uint32_t)zone.first_vertex + zone.vertex_count > g_zones.vertex_count) ||
+			(zone.lat_min > zone.lat_max))
+		{
+			return false;
+		}
+		if (zone.type == ZONE_CIRCLE)
+		{
+			if ((zone.vertex_count != 1) || (zone.radius_m == 0))
+			{
+				return false;
+			}
+		}
+		else if (zone.type != ZONE_POLYGON)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Read the zones from flash and build the index.
+ *        A corrupt file is removed.
+ *
+ */
+void init_zones(void)
+{
+	g_zones.clear();
+	if (zones_file.open(zones_name, FILE_O_READ))
+	{
+		uint16_t counts[2] = {0, 0};
+		zones_file.read((uint8_t *)counts, sizeof(counts));
+		// The size check makes sure the reads below get all the data
+		bool valid = (counts[0] <= ZONE_MAX) && (counts[1] <= ZONE_MAX_VERTICES) &&
+					 (zones_file.size() == sizeof(counts) + counts[0] * sizeof(zone_s) + counts[1] * sizeof(zone_vertex_s));
+		if (valid)
+		{
+			zones_file.read((uint8_t *)g_zones.zones, counts[0] * sizeof(zone_s));
+			zones_file.read((uint8_t *)g_zones.vertices, counts[1] * sizeof(zone_vertex_s));
+			g_zones.zone_count = counts[0];
+			g_zones.vertex_count = counts[1];
+			valid = zones_valid();
+		}
+		zones_file.close();
+		if (!valid)
+		{
+			MYLOG("ZONE", "Zones file corrupt, removed");
+			g_zones.clear();
+			InternalFS.remove(zones_name);
+		}
+	}
+	if (!g_zones.build())
+	{
+		MYLOG("ZONE", "Too many grid entries, checking all zones");
+	}
+	MYLOG("ZONE", "%d zones loaded", g_zones.zone_count);
+}
+
+/**
+ * @brief Build the index and save the zones to flash
+ *
+ * @return true zones saved
+ * @return false file could not be written
+ */
+bool save_zones(void)
+{
+	g_zones.build();
+	InternalFS.remove(zones_name);
+	if (!zones_file.open(zones_name, FILE_O_WRITE))
+	{
+		MYLOG("ZONE", "Failed to save zones");
+		return false;
+	}
+	uint16_t counts[2] = {g_zones.zone_count, g_zones.vertex_count};
+	zones_file.write((uint8_t *)counts, sizeof(counts));
+	zones_file.write((uint8_t *)g_zones.zones, g_zones.zone_count * sizeof(zone_s));
+	zones_file.write((uint8_t *)g_zones.vertices, g_zones.vertex_count * sizeof(zone_vertex_s));
+	zones_file.close();
+	return true;
+}
+
+/**
+ * @brief Apply the exclusion zones to a fix before it is sent
+ *
+ * @param fix position, reduced to the center of a ZONE_GRID_E7 cell
+ *        if it is inside a ZONE_REDUCE zone
+ * @return true send the fix
+ * @return false fix is inside a ZONE_SUPPRESS zone
+ */
+bool zones_apply(gnss_fix_s &fix)
+{
+	int zone = g_zones.find(fix.lat_e7, fix.lon_e7);
+	if (zone < 0)
+	{
+		return true;
+	}
+
+	if (g_zones.zones[zone].mode == ZONE_SUPPRESS)
+	{
+		MYLOG("ZONE", "Position in zone %d, suppressed", zone);
+		return false;
+	}
+
+	MYLOG("ZONE", "Position in zone %d, reduced precision", zone);
+	fix.lat_e7 = (fix.lat_e7 / ZONE_GRID_E7) * ZONE_GRID_E7 + (fix.lat_e7 >= 0 ? ZONE_GRID_E7 / 2 : -ZONE_GRID_E7 / 2);
+	fix.lon_e7 = (fix.lon_e7 / ZONE_GRID_E7) * ZONE_GRID_E7 + (fix.lon_e7 >= 0 ? ZONE_GRID_E7 / 2 : -ZONE_GRID_E7 / 2);
+	fix.alt_mm = 0;
+	return true;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file coverage_filter_tool.cpp
+ * @author agent (agent@local)
+ * @brief Network server side tool for the coverage filter. Builds the
+ *        filter from covered positions and splits it into downlinks,
+ *        measures lookup cost and false positive rate per filter size.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "coverage_filter.h"
+
+/**
+ * @brief Print the usage
+ */
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s build <positions.csv> [--chunk <bytes>]\n"
+			"         positions.csv lines lat,lon in degrees, prints one hex downlink\n"
+			"         per line for fport %d\n"
+			"       %s bench [--cells <n>]\n"
+			"         lookup cost and false positive rate per filter size\n",
+			name, COVERAGE_FPORT, name);
+}
+
+/**
+ * @brief Print a downlink as hex
+ */
+static void print_frame(const uint8_t *frame, size_t len)
+{
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		printf("%02X", frame[idx]);
+	}
+	printf("\n");
+}
+
+/**
+ * @brief Build the filter from positions and print the downlinks.
+ *        All-zero chunks are not sent, they are covered by the clear command.
+ *        For a sparse filter the cells are sent instead if that needs fewer downlinks.
+ */
+static int build(const char *file_name, size_t chunk)
+{
+	FILE *in = fopen(file_name, "r");
+	if (in == NULL)
+	{
+		perror(file_name);
+		return 1;
+	}
+
+	static coverage_filter<COVERAGE_FILTER_BYTES> filter;
+	filter.clear();
+	std::vector<coverage_cell_s> cells;
+	double lat, lon;
+	char line[128];
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (sscanf(line, "%lf,%lf", &lat, &lon) == 2)
+		{
+			coverage_cell_s cell = coverage_cell((int32_t)(lat * 1e7), (int32_t)(lon * 1e7));
+			filter.add(cell);
+			cells.push_back(cell);
+		}
+	}
+	fclose(in);
+
+	std::vector<size_t> chunks;
+	for (size_t offset = 0; offset < sizeof(filter.data); offset += chunk)
+	{
+		size_t len = sizeof(filter.data) - offset < chunk ? sizeof(filter.data) - offset : chunk;
+		for (size_t idx = 0; idx < len; idx++)
+		{
+			if (filter.data[offset + idx] != 0)
+			{
+				chunks.push_back(offset);
+				break;
+			}
+		}
+	}
+
+	size_t cells_per_frame = (chunk + 2) / 8;
+	cells_per_frame = cells_per_frame == 0 ? 1 : cells_per_frame;
+	bool send_cells = (cells.size() + cells_per_frame - 1) / cells_per_frame < chunks.size();
+
+	uint8_t frame[256];
+	frame[0] = COVERAGE_CMD_CLEAR;
+	print_frame(frame, 1);
+	size_t frames = 2;
+	if (send_cells)
+	{
+		for (size_t first = 0; first < cells.size(); first += cells_per_frame)
+		{
+			size_t len = 1;
+			frame[0] = COVERAGE_CMD_CELLS;
+			for (size_t idx = first; (idx < cells.size()) && (idx < first + cells_per_frame); idx++)
+			{
+				uint32_t lat_q = (uint32_t)cells[idx].lat_q;
+				uint32_t lon_q = (uint32_t)cells[idx].lon_q;
+				for (int shift = 24; shift >= 0; shift -= 8)
+				{
+					frame[len++] = (uint8_t)(lat_q >> shift);
+				}
+				for (int shift = 24; shift >= 0; shift -= 8)
+				{
+					frame[len++] = (uint8_t)(lon_q >> shift);
+				}
+			}
+			print_frame(frame, len);
+			frames++;
+		}
+	}
+	else
+	{
+		for (size_t idx = 0; idx < chunks.size(); idx++)
+		{
+			size_t offset = chunks[idx];
+			size_t len = sizeof(filter.data) - offset < chunk ? sizeof(filter.data) - offset : chunk;
+			frame[0] = COVERAGE_CMD_CHUNK;
+			frame[1] = (uint8_t)(offset >> 8);
+			frame[2] = (uint8_t)offset;
+			memcpy(&frame[3], &filter.data[offset], len);
+			print_frame(frame, len + 3);
+			frames++;
+		}
+	}
+	frame[0] = COVERAGE_CMD_SAVE;
+	print_frame(frame, 1);
+	fprintf(stderr, "%zu positions, %zu downlinks\n", cells.size(), frames);
+	return 0;
+}
+
+/**
+ * @brief Measure one filter size
+ *
+ * @tparam Bytes filter size
+ */
+template <uint16_t Bytes>
+static void bench_size(const std::vector<coverage_cell_s> &members, const std::vector<coverage_cell_s> &probes)
+{
+	static coverage_filter<Bytes> filter;
+	filter.clear();
+	for (size_t idx = 0; idx < members.size(); idx++)
+	{
+		filter.add(members[idx]);
+	}
+
+	size_t hits = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < probes.size(); idx++)
+	{
+		hits += filter.contains(probes[idx]) ? 1 : 0;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%6u bytes  %8.2f%% false positives  %6.1f ns/lookup\n",
+		   Bytes, 100.0 * hits / probes.size(), seconds * 1e9 / probes.size());
+}
+
+/**
+ * @brief Lookup cost and false positive rate for several filter sizes
+ */
+static int bench(size_t cells)
+{
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int32_t> lat_q(-3000, 3000);
+	std::uniform_int_distribution<int32_t> lon_q(-6000, 6000);
+
+	// Members in one half of the lon range, probes in the other, so no probe is a member
+	std::vector<coverage_cell_s> members(cells);
+	for (size_t idx = 0; idx < cells; idx++)
+	{
+		members[idx].lat_q = lat_q(rng);
+		members[idx].lon_q = lon_q(rng) | 0x40000000;
+	}
+	std::vector<coverage_cell_s> probes(1000000);
+	for (size_t idx = 0; idx < probes.size(); idx++)
+	{
+		probes[idx].lat_q = lat_q(rng);
+		probes[idx].lon_q = lon_q(rng) & ~0x40000000;
+	}
+
+	printf("%zu cells, %d hashes\n", cells, COVERAGE_HASHES);
+	bench_size<512>(members, probes);
+	bench_size<1024>(members, probes);
+	bench_size<2048>(members, probes);
+	bench_size<4096>(members, probes);
+	bench_size<8192>(members, probes);
+	bench_size<16384>(members, probes);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((strcmp(argv[1], "build") == 0) && (argc >= 3))
+	{
+		size_t chunk = 48;
+		if ((argc >= 5) && (strcmp(argv[3], "--chunk") == 0))
+		{
+			chunk = (size_t)atol(argv[4]);
+		}
+		if ((chunk == 0) || (chunk > 240))
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		return build(argv[2], chunk);
+	}
+
+	if (strcmp(argv[1], "bench") == 0)
+	{
+		size_t cells = 3000;
+		if ((argc >= 4) && (strcmp(argv[2], "--cells") == 0))
+		{
+			cells = (size_t)atol(argv[3]);
+		}
+		return bench(cells);
+	}
+
+	usage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file geo_check.cpp
+ * @author agent (agent@local)
+ * @brief Host check of the fixed point geodesy of the send trigger.
+ *        Compares distance and bearing with haversine and the initial
+ *        great circle bearing, measures the cost per call.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "geo.h"
+
+/** Mean earth radius in meters, same as GEO_M_PER_DEG */
+#define EARTH_RADIUS 6371000.0
+
+/** Allowed distance error, relative, for segments up to max_dist */
+#define MAX_DIST_ERROR 0.005
+
+/** Allowed absolute distance error in meters, covers the 1e-7 degree resolution */
+#define MAX_DIST_ERROR_M 0.05
+
+/** Allowed bearing error in degrees for segments of 10 m and more */
+#define MAX_BEARING_ERROR 0.5
+
+/**
+ * @brief Print the usage
+ */
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s check [--max-dist <m>] [--max-lat <deg>]\n"
+			"         compares with haversine for 1 million random segments\n"
+			"       %s bench\n"
+			"         cost per call of geo_delta() and haversine\n",
+			name, name);
+}
+
+/** Random segment */
+struct segment_s
+{
+	int32_t lat1, lon1, lat2, lon2;
+};
+
+/**
+ * @brief Random segments up to max_dist meters, start latitude up to max_lat
+ */
+static std::vector<segment_s> random_segments(size_t count, double max_dist, double max_lat)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> lat(-max_lat, max_lat);
+	std::uniform_real_distribution<double> lon(-180.0, 180.0);
+	std::uniform_real_distribution<double> dir(0.0, 2 * M_PI);
+	// Log distribution of the length, many short segments as between two fixes
+	std::uniform_real_distribution<double> log_dist(0.0, log(max_dist));
+
+	std::vector<segment_s> segments(count);
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		double lat1 = lat(rng);
+		double lon1 = lon(rng);
+		double dist = exp(log_dist(rng));
+		double angle = dir(rng);
+		double lat2 = lat1 + dist * cos(angle) / EARTH_RADIUS * 180.0 / M_PI;
+		double lon2 = lon1 + dist * sin(angle) / (EARTH_RADIUS * cos(lat1 * M_PI / 180.0)) * 180.0 / M_PI;
+		lon2 = lon2 > 180.0 ? lon2 - 360.0 : (lon2 < -180.0 ? lon2 + 360.0 : lon2);
+		segments[idx].lat1 = (int32_t)lrint(lat1 * 1e7);
+		segments[idx].lon1 = (int32_t)lrint(lon1 * 1e7);
+		segments[idx].lat2 = (int32_t)lrint(lat2 * 1e7);
+		segments[idx].lon2 = (int32_t)lrint(lon2 * 1e7);
+	}
+	return segments;
+}
+
+/**
+ * @brief Haversine distance in meters and initial bearing in degrees
+ */
+static void haversine(const segment_s &seg, double &dist, double &bearing)
+{
+	double lat1 = seg.lat1 / 1e7 * M_PI / 180.0;
+	double lat2 = seg.lat2 / 1e7 * M_PI / 180.0;
+	double dlat = lat2 - lat1;
+	double dlon = ((double)seg.lon2 - seg.lon1) / 1e7 * M_PI / 180.0;
+	dlon = dlon > M_PI ? dlon - 2 * M_PI : (dlon < -M_PI ? dlon + 2 * M_PI : dlon);
+	double a = sin(dlat / 2) * sin(dlat / 2) + cos(lat1) * cos(lat2) * sin(dlon / 2) * sin(dlon / 2);
+	dist = 2 * EARTH_RADIUS * asin(sqrt(a));
+	bearing = atan2(sin(dlon) * cos(lat2), cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(dlon)) * 180.0 / M_PI;
+	bearing = bearing < 0 ? bearing + 360.0 : bearing;
+}
+
+/**
+ * @brief Compare with haversine
+ */
+static int check(double max_dist, double max_lat)
+{
+	std::vector<segment_s> segments = random_segments(1000000, max_dist, max_lat);
+	double max_rel = 0, sum_rel = 0, max_bearing = 0, sum_bearing = 0;
+	size_t bearing_count = 0, failed = 0;
+	for (size_t idx = 0; idx < segments.size(); idx++)
+	{
+		double ref_dist, ref_bearing;
+		haversine(segments[idx], ref_dist, ref_bearing);
+		uint32_t dist_mm;
+		uint16_t bearing_cdeg;
+		geo_delta(segments[idx].lat1, segments[idx].lon1, segments[idx].lat2, segments[idx].lon2, dist_mm, bearing_cdeg);
+
+		double error = fabs(dist_mm / 1000.0 - ref_dist);
+		double rel = ref_dist > 0 ? error / ref_dist : 0;
+		max_rel = rel > max_rel ? rel : max_rel;
+		sum_rel += rel;
+		bool bad = (error > MAX_DIST_ERROR_M) && (rel > MAX_DIST_ERROR);
+
+		if (ref_dist >= 10.0)
+		{
+			double bearing_error = fabs(bearing_cdeg / 100.0 - ref_bearing);
+			bearing_error = bearing_error > 180.0 ? 360.0 - bearing_error : bearing_error;
+			max_bearing = bearing_error > max_bearing ? bearing_error : max_bearing;
+			sum_bearing += bearing_error;
+			bearing_count++;
+			bad |= bearing_error > MAX_BEARING_ERROR;
+		}
+		failed += bad ? 1 : 0;
+	}
+
+	printf("%zu segments up to %.0f m, latitude up to %.0f degrees\n", segments.size(), max_dist, max_lat);
+	printf("distance error  mean %.4f%%  max %.4f%%\n", 100.0 * sum_rel / segments.size(), 100.0 * max_rel);
+	printf("bearing error   mean %.4f deg  max %.4f deg (segments >= 10 m)\n",
+		   bearing_count ? sum_bearing / bearing_count : 0.0, max_bearing);
+	printf("%zu segments outside %.1f%% / %.1f deg\n", failed, 100.0 * MAX_DIST_ERROR, MAX_BEARING_ERROR);
+	return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Cost per call
+ */
+static int bench(void)
+{
+	std::vector<segment_s> segments = random_segments(1000000, 5000.0, 80.0);
+	uint64_t sum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < segments.size(); idx++)
+	{
+		uint32_t dist_mm;
+		uint16_t bearing_cdeg;
+		geo_delta(segments[idx].lat1, segments[idx].lon1, segments[idx].lat2, segments[idx].lon2, dist_mm, bearing_cdeg);
+		sum += dist_mm + bearing_cdeg;
+	}
+	double fixed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double ref_sum = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < segments.size(); idx++)
+	{
+		double dist, bearing;
+		haversine(segments[idx], dist, bearing);
+		ref_sum += dist + bearing;
+	}
+	double ref_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("geo_delta  %6.1f ns/call\n", fixed_seconds * 1e9 / segments.size());
+	printf("haversine  %6.1f ns/call (double, with FPU)\n", ref_seconds * 1e9 / segments.size());
+	// Keep the results alive
+	return (sum == 0) && (ref_sum == 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (strcmp(argv[1], "check") == 0)
+	{
+		double max_dist = 5000.0;
+		double max_lat = 80.0;
+		for (int idx = 2; idx + 1 < argc; idx += 2)
+		{
+			if (strcmp(argv[idx], "--max-dist") == 0)
+			{
+				max_dist = atof(argv[idx + 1]);
+			}
+			else if (strcmp(argv[idx], "--max-lat") == 0)
+			{
+				max_lat = atof(argv[idx + 1]);
+			}
+			else
+			{
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		return check(max_dist, max_lat);
+	}
+
+	if (strcmp(argv[1], "bench") == 0)
+	{
+		return bench();
+	}
+
+	usage(argv[0]);
+	return 1;
+}
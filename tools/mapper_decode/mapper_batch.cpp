@@ -0,0 +1,296 @@
+/**
+ * @file mapper_batch.cpp
+ * @author agent (agent@local)
+ * @brief Host side batch decoder for mapper uplinks
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "mapper_batch.h"
+
+/** Record of one format bucket, offset of the payload and row in the columns */
+struct bucket_entry_s
+{
+	size_t offset;
+	size_t row;
+};
+
+/**
+ * @brief Reserve space for rows in all columns
+ */
+void mapper_columns_s::reserve(size_t rows)
+{
+	lat_e7.reserve(rows);
+	lon_e7.reserve(rows);
+	alt_mm.reserve(rows);
+	hdop_e2.reserve(rows);
+	sats.reserve(rows);
+	batt_mv.reserve(rows);
+	age_min.reserve(rows);
+	dr.reserve(rows);
+	seq.reserve(rows);
+	fport.reserve(rows);
+	timestamp.reserve(rows);
+}
+
+/**
+ * @brief Remove all rows
+ */
+void mapper_columns_s::clear(void)
+{
+	lat_e7.clear();
+	lon_e7.clear();
+	alt_mm.clear();
+	hdop_e2.clear();
+	sats.clear();
+	batt_mv.clear();
+	age_min.clear();
+	dr.clear();
+	seq.clear();
+	fport.clear();
+	timestamp.clear();
+}
+
+/**
+ * @brief Resize all columns
+ */
+static void resize_columns(mapper_columns_s &columns, size_t rows)
+{
+	columns.lat_e7.resize(rows);
+	columns.lon_e7.resize(rows);
+	columns.alt_mm.resize(rows);
+	columns.hdop_e2.resize(rows);
+	columns.sats.resize(rows);
+	columns.batt_mv.resize(rows);
+	columns.age_min.resize(rows);
+	columns.dr.resize(rows);
+	columns.seq.resize(rows);
+	columns.fport.resize(rows);
+	columns.timestamp.resize(rows);
+}
+
+/**
+ * @brief Store decoded values in a row
+ */
+static inline void store_row(mapper_columns_s &columns, size_t row, const payload_values_s &values)
+{
+	columns.lat_e7[row] = values.lat_e7;
+	columns.lon_e7[row] = values.lon_e7;
+	columns.alt_mm[row] = values.alt_mm;
+	columns.hdop_e2[row] = values.hdop_e2;
+	columns.sats[row] = values.sats;
+	columns.batt_mv[row] = values.batt_mv;
+	columns.age_min[row] = values.age_min;
+	columns.dr[row] = values.dr;
+	columns.seq[row] = values.seq;
+}
+
+/**
+ * @brief Decode all records of one format. The format is fixed at compile
+ *        time, so the loop body has no length checks or port dispatch.
+ *
+ * @tparam Format payload format from payload.h
+ */
+template <class Format>
+static void decode_bucket(const uint8_t *data, const std::vector<bucket_entry_s> &bucket, mapper_columns_s &columns)
+{
+	const size_t count = bucket.size();
+	const bucket_entry_s *entries = bucket.data();
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		payload_values_s values;
+		Format::decode(data + entries[idx].offset, Format::size, values);
+		store_row(columns, entries[idx].row, values);
+	}
+}
+
+/**
+ * @brief Decode all records of a binary archive into columns.
+ *        First pass indexes the records and sorts them into one bucket
+ *        per format, second pass decodes each bucket in a tight loop.
+ */
+mapper_batch_stats_s mapper_decode_records(const uint8_t *data, size_t len, mapper_columns_s &columns)
+{
+	mapper_batch_stats_s stats;
+	std::vector<bucket_entry_s> bucket_v1;
+	std::vector<bucket_entry_s> bucket_v2;
+	std::vector<bucket_entry_s> bucket_still;
+	std::vector<bucket_entry_s> bucket_survey;
+	std::vector<bucket_entry_s> bucket_compact;
+
+	// Upper estimate, every record carries at least a V1 payload
+	bucket_v1.reserve(len / (MAPPER_RECORD_HEADER + payload_v1::size) + 1);
+
+	size_t row = columns.size();
+	size_t first_row = row;
+	size_t pos = 0;
+	std::vector<uint32_t> timestamps;
+	std::vector<uint8_t> fports;
+
+	while (pos + MAPPER_RECORD_HEADER <= len)
+	{
+		const uint8_t *rec = data + pos;
+		uint8_t fport = rec[4];
+		uint8_t payload_len = rec[5];
+		if (pos + MAPPER_RECORD_HEADER + payload_len > len)
+		{
+			break;
+		}
+		stats.records++;
+
+		bucket_entry_s entry = {pos + MAPPER_RECORD_HEADER, row};
+		if ((fport == payload_v2::fport) && (payload_len == payload_v2::size))
+		{
+			bucket_v2.push_back(entry);
+		}
+		else if ((fport == payload_still::fport) && (payload_len == payload_still::size))
+		{
+			bucket_still.push_back(entry);
+		}
+		else if ((fport == payload_survey::fport) && (payload_len == payload_survey::size))
+		{
+			bucket_survey.push_back(entry);
+		}
+		else if ((fport == payload_compact::fport) && (payload_len == payload_compact::size))
+		{
+			bucket_compact.push_back(entry);
+		}
+		else if ((fport != payload_v2::fport) && (fport != payload_still::fport) && (fport != payload_survey::fport) &&
+				 (fport != payload_compact::fport) && (payload_len == payload_v1::size))
+		{
+			bucket_v1.push_back(entry);
+		}
+		else
+		{
+			stats.rejected++;
+			pos += MAPPER_RECORD_HEADER + payload_len;
+			continue;
+		}
+		timestamps.push_back((uint32_t)rec[0] | ((uint32_t)rec[1] << 8) | ((uint32_t)rec[2] << 16) | ((uint32_t)rec[3] << 24));
+		fports.push_back(fport);
+		row++;
+		pos += MAPPER_RECORD_HEADER + payload_len;
+	}
+	stats.truncated = len - pos;
+
+	resize_columns(columns, row);
+	for (size_t idx = 0; idx < timestamps.size(); idx++)
+	{
+		columns.timestamp[first_row + idx] = timestamps[idx];
+		columns.fport[first_row + idx] = fports[idx];
+	}
+
+	decode_bucket<payload_v1>(data, bucket_v1, columns);
+	decode_bucket<payload_v2>(data, bucket_v2, columns);
+	decode_bucket<payload_still>(data, bucket_still, columns);
+	decode_bucket<payload_survey>(data, bucket_survey, columns);
+	decode_bucket<payload_compact>(data, bucket_compact, columns);
+
+	stats.decoded = row - first_row;
+	return stats;
+}
+
+/**
+ * @brief Parse an unsigned decimal number
+ */
+static const char *parse_uint(const char *pos, const char *end, uint32_t &value)
+{
+	value = 0;
+	while ((pos < end) && (*pos >= '0') && (*pos <= '9'))
+	{
+		value = value * 10 + (*pos - '0');
+		pos++;
+	}
+	return pos;
+}
+
+/**
+ * @brief Convert an ASCII hex digit, -1 if invalid
+ */
+static int hex_nibble(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/**
+ * @brief Decode CSV lines "timestamp,fport,hexpayload" into columns
+ */
+mapper_batch_stats_s mapper_decode_csv(const char *data, size_t len, mapper_columns_s &columns)
+{
+	mapper_batch_stats_s stats;
+	const char *pos = data;
+	const char *end = data + len;
+	uint8_t payload[255];
+
+	while (pos < end)
+	{
+		const char *line_end = pos;
+		while ((line_end < end) && (*line_end != '\n'))
+		{
+			line_end++;
+		}
+
+		uint32_t timestamp;
+		uint32_t fport;
+		const char *field = parse_uint(pos, line_end, timestamp);
+		bool valid = (field != pos) && (field < line_end) && (*field == ',');
+		if (valid)
+		{
+			const char *port_start = field + 1;
+			field = parse_uint(port_start, line_end, fport);
+			valid = (field != port_start) && (field < line_end) && (*field == ',') && (fport < 256);
+		}
+
+		uint8_t payload_len = 0;
+		if (valid)
+		{
+			field++;
+			while ((field + 1 < line_end) && (payload_len < sizeof(payload)))
+			{
+				int high = hex_nibble(field[0]);
+				int low = hex_nibble(field[1]);
+				if ((high < 0) || (low < 0))
+				{
+					break;
+				}
+				payload[payload_len++] = (uint8_t)((high << 4) | low);
+				field += 2;
+			}
+		}
+
+		if (line_end != pos)
+		{
+			stats.records++;
+			payload_values_s values;
+			if (valid && payload_decode((uint8_t)fport, payload, payload_len, values))
+			{
+				size_t row = columns.size();
+				resize_columns(columns, row + 1);
+				store_row(columns, row, values);
+				columns.timestamp[row] = timestamp;
+				columns.fport[row] = (uint8_t)fport;
+				stats.decoded++;
+			}
+			else
+			{
+				stats.rejected++;
+			}
+		}
+		pos = line_end + 1;
+	}
+	return stats;
+}
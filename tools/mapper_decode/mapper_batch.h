@@ -0,0 +1,79 @@
+/**
+ * @file mapper_batch.h
+ * @author agent (agent@local)
+ * @brief Host side batch decoder for mapper uplinks. Uses the payload
+ *        formats of the firmware (src/payload.h) as single source of truth.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef MAPPER_BATCH_H
+#define MAPPER_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "payload.h"
+
+/**
+ * Binary record layout of an uplink archive, all little endian:
+ *   uint32_t timestamp  Unix time of the uplink
+ *   uint8_t  fport      LoRaWAN port
+ *   uint8_t  len        payload length
+ *   uint8_t  payload[len]
+ */
+#define MAPPER_RECORD_HEADER 6
+
+/** Decoded uplinks in columnar form */
+struct mapper_columns_s
+{
+	std::vector<int32_t> lat_e7;
+	std::vector<int32_t> lon_e7;
+	std::vector<int32_t> alt_mm;
+	std::vector<uint16_t> hdop_e2;
+	std::vector<uint8_t> sats; // 0 for formats without satellite count
+	std::vector<uint16_t> batt_mv;
+	std::vector<uint16_t> age_min;
+	std::vector<uint8_t> dr;
+	std::vector<uint16_t> seq;
+	std::vector<uint8_t> fport;
+	std::vector<uint32_t> timestamp;
+
+	size_t size(void) const { return timestamp.size(); }
+	void reserve(size_t rows);
+	void clear(void);
+};
+
+/** Result counters of a batch */
+struct mapper_batch_stats_s
+{
+	size_t records = 0;	 // Records found in the input
+	size_t decoded = 0;	 // Rows appended to the columns
+	size_t rejected = 0; // Records with unknown port or wrong length
+	size_t truncated = 0; // Bytes at the end of the input that do not form a record
+};
+
+/**
+ * @brief Decode all records of a binary archive into columns
+ *
+ * @param data start of the archive, e.g. a memory mapped file
+ * @param len length of the archive
+ * @param columns decoded rows are appended here
+ * @return mapper_batch_stats_s counters
+ */
+mapper_batch_stats_s mapper_decode_records(const uint8_t *data, size_t len, mapper_columns_s &columns);
+
+/**
+ * @brief Decode CSV lines "timestamp,fport,hexpayload" into columns
+ *
+ * @param data start of the text
+ * @param len length of the text
+ * @param columns decoded rows are appended here
+ * @return mapper_batch_stats_s counters
+ */
+mapper_batch_stats_s mapper_decode_csv(const char *data, size_t len, mapper_columns_s &columns);
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file mapper_decode.cpp
+ * @author agent (agent@local)
+ * @brief Command line tool to decode archived mapper uplinks into CSV
+ *        and to measure the decoder throughput.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include "mapper_batch.h"
+
+/**
+ * @brief Print the usage
+ */
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options] <input>\n"
+			"  --csv          input is CSV lines timestamp,fport,hexpayload\n"
+			"                 default is the binary record archive\n"
+			"  --out <file>   write the decoded columns as CSV, default stdout\n"
+			"  --bench <n>    decode the input n times and report payloads/sec\n"
+			"  --generate <n> write n synthetic V1/V2 records to <input>\n",
+			name);
+}
+
+/**
+ * @brief Write a synthetic binary archive for benchmarking
+ */
+static int generate(const char *file_name, size_t count)
+{
+	FILE *out = fopen(file_name, "wb");
+	if (out == NULL)
+	{
+		perror(file_name);
+		return 1;
+	}
+	srand(1);
+	uint8_t rec[MAPPER_RECORD_HEADER + PAYLOAD_MAX_LEN];
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		payload_values_s values;
+		values.lat_e7 = (rand() % 1800000000) - 900000000;
+		values.lon_e7 = (rand() % 2000000000) - 1000000000;
+		values.alt_mm = (rand() % 2000000) - 100000;
+		values.hdop_e2 = rand() % 2000;
+		values.sats = rand() % 20;
+		values.batt_mv = 3300 + rand() % 900;
+
+		uint32_t timestamp = 1700000000 + (uint32_t)idx;
+		bool use_v2 = (idx % 4) == 0;
+		rec[0] = (uint8_t)timestamp;
+		rec[1] = (uint8_t)(timestamp >> 8);
+		rec[2] = (uint8_t)(timestamp >> 16);
+		rec[3] = (uint8_t)(timestamp >> 24);
+		rec[4] = use_v2 ? payload_v2::fport : 2;
+		rec[5] = use_v2 ? payload_v2::encode(&rec[MAPPER_RECORD_HEADER], values)
+						: payload_v1::encode(&rec[MAPPER_RECORD_HEADER], values);
+		fwrite(rec, 1, MAPPER_RECORD_HEADER + rec[5], out);
+	}
+	fclose(out);
+	return 0;
+}
+
+/**
+ * @brief Write the columns as CSV
+ */
+static void write_csv(FILE *out, const mapper_columns_s &columns)
+{
+	fprintf(out, "timestamp,fport,lat,lon,alt,hdop,sats,batt,age,dr,seq\n");
+	for (size_t row = 0; row < columns.size(); row++)
+	{
+		fprintf(out, "%u,%u,%.7f,%.7f,%.3f,%.2f,%u,%.3f,%u,%u,%u\n",
+				columns.timestamp[row], columns.fport[row],
+				columns.lat_e7[row] / 1e7, columns.lon_e7[row] / 1e7,
+				columns.alt_mm[row] / 1e3, columns.hdop_e2[row] / 1e2, columns.sats[row],
+				columns.batt_mv[row] / 1e3, columns.age_min[row],
+				columns.dr[row], columns.seq[row]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool csv_input = false;
+	const char *out_name = NULL;
+	const char *in_name = NULL;
+	long bench_runs = 0;
+	long generate_count = 0;
+
+	for (int idx = 1; idx < argc; idx++)
+	{
+		if (strcmp(argv[idx], "--csv") == 0)
+		{
+			csv_input = true;
+		}
+		else if ((strcmp(argv[idx], "--out") == 0) && (idx + 1 < argc))
+		{
+			out_name = argv[++idx];
+		}
+		else if ((strcmp(argv[idx], "--bench") == 0) && (idx + 1 < argc))
+		{
+			bench_runs = atol(argv[++idx]);
+		}
+		else if ((strcmp(argv[idx], "--generate") == 0) && (idx + 1 < argc))
+		{
+			generate_count = atol(argv[++idx]);
+		}
+		else if (argv[idx][0] != '-')
+		{
+			in_name = argv[idx];
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (in_name == NULL)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (generate_count > 0)
+	{
+		return generate(in_name, (size_t)generate_count);
+	}
+
+	int fd = open(in_name, O_RDONLY);
+	struct stat file_stat;
+	if ((fd < 0) || (fstat(fd, &file_stat) != 0))
+	{
+		perror(in_name);
+		return 1;
+	}
+	size_t len = (size_t)file_stat.st_size;
+	const uint8_t *data = NULL;
+	if (len != 0)
+	{
+		void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			perror("mmap");
+			close(fd);
+			return 1;
+		}
+		madvise(map, len, MADV_SEQUENTIAL);
+		data = (const uint8_t *)map;
+	}
+
+	mapper_columns_s columns;
+	mapper_batch_stats_s stats;
+	long runs = bench_runs > 0 ? bench_runs : 1;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long run = 0; run < runs; run++)
+	{
+		columns.clear();
+		stats = csv_input ? mapper_decode_csv((const char *)data, len, columns)
+						  : mapper_decode_records(data, len, columns);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stderr, "records %zu decoded %zu rejected %zu truncated bytes %zu\n",
+			stats.records, stats.decoded, stats.rejected, stats.truncated);
+
+	if (bench_runs > 0)
+	{
+		double payloads = (double)stats.records * runs;
+		fprintf(stderr, "%ld runs in %.3f s, %.0f payloads/sec, %.1f MB/s\n",
+				runs, seconds, payloads / seconds, (double)len * runs / seconds / 1e6);
+	}
+	else
+	{
+		FILE *out = out_name != NULL ? fopen(out_name, "w") : stdout;
+		if (out == NULL)
+		{
+			perror(out_name);
+			return 1;
+		}
+		write_csv(out, columns);
+		if (out != stdout)
+		{
+			fclose(out);
+		}
+	}
+
+	if (data != NULL)
+	{
+		munmap((void *)data, len);
+	}
+	close(fd);
+	return 0;
+}
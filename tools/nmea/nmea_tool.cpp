@@ -0,0 +1,506 @@
+/**
+ * @file nmea_tool.cpp
+ * @author agent (agent@local)
+ * @brief Host checks of the streaming NMEA parser. Runs a corpus of
+ *        sentences with expected values, fuzzes the parser with mutated
+ *        sentences and measures its throughput, optionally against TinyGPSPlus.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "nmea.h"
+
+#ifdef NMEA_BENCH_TINYGPSPLUS
+#include <TinyGPS++.h>
+#endif
+
+/**
+ * @brief Print the usage
+ */
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s check <corpus.txt>\n"
+			"         runs the corpus, exits with 1 if a value differs\n"
+			"       %s fuzz <corpus.txt> [--iterations <n>] [--seed <n>]\n"
+			"         feeds mutated corpus sentences, exits with 1 if an invariant breaks\n"
+			"       %s bench [--sentences <n>]\n"
+			"         throughput of nmea_parser"
+#ifdef NMEA_BENCH_TINYGPSPLUS
+			" and TinyGPSPlus"
+#endif
+			"\n",
+			name, name, name);
+}
+
+/** One input line of a corpus case */
+struct corpus_input_s
+{
+	std::string text;
+	bool line_end;
+};
+
+/** One corpus case */
+struct corpus_case_s
+{
+	std::string name;
+	std::vector<corpus_input_s> inputs;
+	std::string expect;
+};
+
+/**
+ * @brief Replace \xNN escapes
+ */
+static std::string unescape(const char *text)
+{
+	std::string result;
+	for (const char *pos = text; *pos != 0; pos++)
+	{
+		if ((pos[0] == '\\') && (pos[1] == 'x') && (pos[2] != 0) && (pos[3] != 0))
+		{
+			char hex[3] = {pos[2], pos[3], 0};
+			result += (char)strtol(hex, NULL, 16);
+			pos += 3;
+		}
+		else
+		{
+			result += *pos;
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Read the corpus file
+ */
+static bool read_corpus(const char *file_name, std::vector<corpus_case_s> &cases)
+{
+	FILE *in = fopen(file_name, "r");
+	if (in == NULL)
+	{
+		perror(file_name);
+		return false;
+	}
+	char line[512];
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (strncmp(line, "CASE ", 5) == 0)
+		{
+			cases.push_back(corpus_case_s());
+			cases.back().name = &line[5];
+		}
+		else if (cases.empty())
+		{
+			continue;
+		}
+		else if (strncmp(line, "IN ", 3) == 0)
+		{
+			corpus_input_s input = {unescape(&line[3]), true};
+			cases.back().inputs.push_back(input);
+		}
+		else if (strncmp(line, "RAW ", 4) == 0)
+		{
+			corpus_input_s input = {unescape(&line[4]), false};
+			cases.back().inputs.push_back(input);
+		}
+		else if (strncmp(line, "EXPECT ", 7) == 0)
+		{
+			cases.back().expect = &line[7];
+		}
+	}
+	fclose(in);
+	return true;
+}
+
+/**
+ * @brief Feed a string, returns the OR of the sentence types returned
+ */
+static uint8_t feed(nmea_parser &parser, const std::string &text, bool line_end)
+{
+	uint8_t types = NMEA_NONE;
+	for (size_t idx = 0; idx < text.size(); idx++)
+	{
+		types |= parser.encode(text[idx]);
+	}
+	if (line_end)
+	{
+		types |= parser.encode('\r');
+		types |= parser.encode('\n');
+	}
+	return types;
+}
+
+/**
+ * @brief Parse a types list like GGA|RMC
+ */
+static long parse_types(const char *text)
+{
+	long types = NMEA_NONE;
+	types |= strstr(text, "GGA") != NULL ? NMEA_GGA : 0;
+	types |= strstr(text, "RMC") != NULL ? NMEA_RMC : 0;
+	types |= strstr(text, "GSA") != NULL ? NMEA_GSA : 0;
+	return types;
+}
+
+/**
+ * @brief Value of a named field, false if the name is unknown
+ */
+static bool field_value(const nmea_parser &parser, uint8_t types, const char *name, long &value)
+{
+	const nmea_data_s &data = parser.data;
+	struct
+	{
+		const char *name;
+		long value;
+	} fields[] = {
+		{"types", types},
+		{"lat", data.lat_e7},
+		{"lon", data.lon_e7},
+		{"alt", data.alt_mm},
+		{"hdop", data.hdop_e2},
+		{"sats", data.sats},
+		{"quality", data.quality},
+		{"time", (long)data.time_hms},
+		{"date", (long)data.date_dmy},
+		{"speed", data.speed_e2},
+		{"course", data.course_e2},
+		{"rmc", data.rmc_valid ? 1 : 0},
+		{"fix", data.fix_type},
+		{"pdop", data.pdop_e2},
+		{"passed", (long)parser.passed_checksum},
+		{"failed", (long)parser.failed_checksum},
+	};
+	for (size_t idx = 0; idx < sizeof(fields) / sizeof(fields[0]); idx++)
+	{
+		if (strcmp(fields[idx].name, name) == 0)
+		{
+			value = fields[idx].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Run all corpus cases, each with a new parser
+ */
+static int check(const char *file_name)
+{
+	std::vector<corpus_case_s> cases;
+	if (!read_corpus(file_name, cases))
+	{
+		return 1;
+	}
+
+	size_t failed = 0;
+	for (size_t idx = 0; idx < cases.size(); idx++)
+	{
+		const corpus_case_s &test = cases[idx];
+		nmea_parser parser;
+		uint8_t types = NMEA_NONE;
+		for (size_t input = 0; input < test.inputs.size(); input++)
+		{
+			types |= feed(parser, test.inputs[input].text, test.inputs[input].line_end);
+		}
+
+		bool ok = true;
+		char expect[512];
+		snprintf(expect, sizeof(expect), "%s", test.expect.c_str());
+		for (char *item = strtok(expect, " "); item != NULL; item = strtok(NULL, " "))
+		{
+			char *equal = strchr(item, '=');
+			long actual = 0;
+			if ((equal == NULL) || (*equal = 0, !field_value(parser, types, item, actual)))
+			{
+				printf("%-48s invalid expectation %s\n", test.name.c_str(), item);
+				ok = false;
+				continue;
+			}
+			long wanted = strcmp(item, "types") == 0 ? parse_types(equal + 1) : strtol(equal + 1, NULL, 10);
+			if (actual != wanted)
+			{
+				printf("%-48s %s is %ld, expected %ld\n", test.name.c_str(), item, actual, wanted);
+				ok = false;
+			}
+		}
+		failed += ok ? 0 : 1;
+	}
+	printf("%zu cases, %zu failed\n", cases.size(), failed);
+	return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Replace the checksum of a sentence with the correct one, so
+ *        mutations reach the field decoding
+ */
+static void fix_checksum(std::string &sentence)
+{
+	size_t start = sentence.find('$');
+	size_t star = sentence.find('*', start == std::string::npos ? 0 : start);
+	if ((start == std::string::npos) || (star == std::string::npos))
+	{
+		return;
+	}
+	uint8_t checksum = 0;
+	for (size_t idx = start + 1; idx < star; idx++)
+	{
+		checksum ^= (uint8_t)sentence[idx];
+	}
+	char hex[3];
+	snprintf(hex, sizeof(hex), "%02X", checksum);
+	sentence = sentence.substr(0, star + 1) + hex;
+}
+
+/**
+ * @brief Compare the decoded values
+ */
+static bool same_data(const nmea_data_s &a, const nmea_data_s &b)
+{
+	return (a.lat_e7 == b.lat_e7) && (a.lon_e7 == b.lon_e7) && (a.alt_mm == b.alt_mm) &&
+		   (a.time_hms == b.time_hms) && (a.date_dmy == b.date_dmy) && (a.hdop_e2 == b.hdop_e2) &&
+		   (a.pdop_e2 == b.pdop_e2) && (a.speed_e2 == b.speed_e2) && (a.course_e2 == b.course_e2) &&
+		   (a.sats == b.sats) && (a.quality == b.quality) && (a.fix_type == b.fix_type) && (a.rmc_valid == b.rmc_valid);
+}
+
+/**
+ * @brief Feed mutated corpus sentences into one long lived parser.
+ *        Checks after every character that the values only change when a
+ *        sentence is accepted, that coordinates stay in range and that the
+ *        parser finds the next valid sentence after any garbage.
+ */
+static int fuzz(const char *file_name, size_t iterations, uint32_t seed)
+{
+	std::vector<corpus_case_s> cases;
+	if (!read_corpus(file_name, cases))
+	{
+		return 1;
+	}
+	std::vector<std::string> seeds;
+	for (size_t idx = 0; idx < cases.size(); idx++)
+	{
+		for (size_t input = 0; input < cases[idx].inputs.size(); input++)
+		{
+			seeds.push_back(cases[idx].inputs[input].text);
+		}
+	}
+	if (seeds.empty())
+	{
+		fprintf(stderr, "No sentences in %s\n", file_name);
+		return 1;
+	}
+
+	static const char alphabet[] = "$*,.-0123456789ABCDEFNSEWGPRMCAV\r\n";
+	static const std::string resync = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+	std::mt19937 rng(seed);
+	nmea_parser parser;
+	size_t accepted = 0;
+	size_t errors = 0;
+	for (size_t iteration = 0; (iteration < iterations) && (errors < 10); iteration++)
+	{
+		std::string text = seeds[rng() % seeds.size()];
+		int mutations = 1 + rng() % 4;
+		for (int count = 0; count < mutations; count++)
+		{
+			size_t pos = text.empty() ? 0 : rng() % text.size();
+			switch (rng() % 5)
+			{
+			case 0: // Flip a bit
+				if (!text.empty())
+				{
+					text[pos] ^= (char)(1 << (rng() % 8));
+				}
+				break;
+			case 1: // Truncate
+				text.resize(pos);
+				break;
+			case 2: // Insert a character that means something to the parser
+				text.insert(pos, 1, alphabet[rng() % (sizeof(alphabet) - 1)]);
+				break;
+			case 3: // Overlong field
+				text.insert(pos, std::string(1 + rng() % 40, (char)('0' + rng() % 10)));
+				break;
+			case 4: // Random byte
+				text.insert(pos, 1, (char)(rng() & 0xFF));
+				break;
+			}
+		}
+		if (rng() % 2)
+		{
+			fix_checksum(text);
+		}
+		text += rng() % 4 ? "\r\n" : "";
+
+		for (size_t idx = 0; (idx < text.size()) && (errors < 10); idx++)
+		{
+			nmea_data_s before = parser.data;
+			uint32_t passed = parser.passed_checksum;
+			uint8_t type = parser.encode(text[idx]);
+			if ((type == NMEA_NONE) && (!same_data(before, parser.data) || (passed != parser.passed_checksum)))
+			{
+				printf("Values changed without an accepted sentence: %s\n", text.c_str());
+				errors++;
+			}
+			if ((type != NMEA_NONE) && (passed + 1 != parser.passed_checksum))
+			{
+				printf("Sentence returned without counting it: %s\n", text.c_str());
+				errors++;
+			}
+			if ((parser.data.lat_e7 > 900000000) || (parser.data.lat_e7 < -900000000) ||
+				(parser.data.lon_e7 > 1800000000) || (parser.data.lon_e7 < -1800000000))
+			{
+				printf("Coordinate out of range: %s\n", text.c_str());
+				errors++;
+			}
+			accepted += type != NMEA_NONE ? 1 : 0;
+		}
+
+		// Every mutated sentence is followed by a valid one half of the time
+		if (rng() % 2)
+		{
+			if ((feed(parser, resync, false) != NMEA_GGA) || (parser.data.lat_e7 != 481173000) || (parser.data.lon_e7 != 115166667))
+			{
+				printf("No resync after: %s\n", text.c_str());
+				errors++;
+			}
+		}
+	}
+	printf("%zu iterations, %zu mutated sentences accepted, %u bad checksums, %zu errors\n",
+		   iterations, accepted, parser.failed_checksum, errors);
+	return errors == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Append a sentence with checksum and line end
+ */
+static void add_sentence(std::string &stream, const char *body)
+{
+	uint8_t checksum = 0;
+	for (const char *pos = body; *pos != 0; pos++)
+	{
+		checksum ^= (uint8_t)*pos;
+	}
+	char tail[8];
+	snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+	stream += '$';
+	stream += body;
+	stream += tail;
+}
+
+/**
+ * @brief Stream like a u-blox module sends it once per second
+ *        (GGA, RMC, GSA and three GSV), positions along a track
+ */
+static std::string bench_stream(size_t epochs)
+{
+	std::string stream;
+	char body[128];
+	for (size_t epoch = 0; epoch < epochs; epoch++)
+	{
+		unsigned lat_min = 700000 + (unsigned)(epoch * 37 % 5000000);
+		unsigned lon_min = 1800000 + (unsigned)(epoch * 53 % 5000000);
+		unsigned hms = (unsigned)(epoch % 24) * 10000 + (unsigned)(epoch % 60) * 100 + (unsigned)(epoch % 60);
+		snprintf(body, sizeof(body), "GPGGA,%06u.00,48%02u.%05u,N,011%02u.%05u,E,1,08,0.9,545.4,M,46.9,M,,",
+				 hms, lat_min / 100000 % 60, lat_min % 100000, lon_min / 100000 % 60, lon_min % 100000);
+		add_sentence(stream, body);
+		snprintf(body, sizeof(body), "GPRMC,%06u.00,A,48%02u.%05u,N,011%02u.%05u,E,022.4,084.4,230394,,,A",
+				 hms, lat_min / 100000 % 60, lat_min % 100000, lon_min / 100000 % 60, lon_min % 100000);
+		add_sentence(stream, body);
+		add_sentence(stream, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+		add_sentence(stream, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+		add_sentence(stream, "GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00");
+		add_sentence(stream, "GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00");
+	}
+	return stream;
+}
+
+/**
+ * @brief Throughput of the parsers on the same stream
+ */
+static int bench(size_t epochs)
+{
+	std::string stream = bench_stream(epochs);
+
+	nmea_parser parser;
+	size_t sentences = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < stream.size(); idx++)
+	{
+		sentences += parser.encode(stream[idx]) != NMEA_NONE ? 1 : 0;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%zu bytes, %zu epochs\n", stream.size(), epochs);
+	printf("nmea_parser  %8.1f MB/s  %6.2f ns/char  %zu sentences decoded  lat %.7f lon %.7f\n",
+		   stream.size() / seconds / 1e6, seconds * 1e9 / stream.size(), sentences,
+		   parser.data.lat_e7 / 1e7, parser.data.lon_e7 / 1e7);
+	printf("             %zu bytes of parser state\n", sizeof(nmea_parser));
+
+#ifdef NMEA_BENCH_TINYGPSPLUS
+	TinyGPSPlus gps;
+	start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < stream.size(); idx++)
+	{
+		gps.encode(stream[idx]);
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("TinyGPSPlus  %8.1f MB/s  %6.2f ns/char  %lu sentences passed  lat %.7f lon %.7f\n",
+		   stream.size() / seconds / 1e6, seconds * 1e9 / stream.size(), (unsigned long)gps.passedChecksum(),
+		   gps.location.lat(), gps.location.lng());
+	printf("             %zu bytes of parser state\n", sizeof(TinyGPSPlus));
+#endif
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((strcmp(argv[1], "check") == 0) && (argc >= 3))
+	{
+		return check(argv[2]);
+	}
+
+	if ((strcmp(argv[1], "fuzz") == 0) && (argc >= 3))
+	{
+		size_t iterations = 1000000;
+		uint32_t seed = 1;
+		for (int arg = 3; arg + 1 < argc; arg += 2)
+		{
+			if (strcmp(argv[arg], "--iterations") == 0)
+			{
+				iterations = (size_t)atol(argv[arg + 1]);
+			}
+			else if (strcmp(argv[arg], "--seed") == 0)
+			{
+				seed = (uint32_t)atol(argv[arg + 1]);
+			}
+		}
+		return fuzz(argv[2], iterations, seed);
+	}
+
+	if (strcmp(argv[1], "bench") == 0)
+	{
+		size_t epochs = 100000;
+		if ((argc >= 4) && (strcmp(argv[2], "--sentences") == 0))
+		{
+			epochs = (size_t)atol(argv[3]) / 6;
+		}
+		return bench(epochs == 0 ? 1 : epochs);
+	}
+
+	usage(argv[0]);
+	return 1;
+}
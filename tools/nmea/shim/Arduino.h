@@ -0,0 +1,42 @@
+/**
+ * @file Arduino.h
+ * @author agent (agent@local)
+ * @brief Minimal Arduino environment to build TinyGPSPlus on the host
+ *        for the comparison in nmea_tool bench
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef NMEA_SHIM_ARDUINO_H
+#define NMEA_SHIM_ARDUINO_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+typedef uint8_t byte;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#ifndef TWO_PI
+#define TWO_PI 6.283185307179586476925286766559
+#endif
+#define radians(deg) ((deg) * (PI / 180.0))
+#define degrees(rad) ((rad) * (180.0 / PI))
+#define sq(x) ((x) * (x))
+
+static inline unsigned long millis(void)
+{
+	return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ * @file zones_tool.cpp
+ * @author agent (agent@local)
+ * @brief Host tool for the exclusion zones. Converts a zone list into
+ *        AT commands for provisioning, checks the grid index and a scan
+ *        of all zones against known positions and measures the lookup cost.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "zone_index.h"
+
+/** Vertices per AT command, keeps the command below the AT buffer size */
+#define AT_VERTICES 4
+
+/** Position with the zone it is expected in */
+struct zone_point_s
+{
+	int zone; // Zone id in file order, -1 outside of all zones
+	int32_t lat_e7;
+	int32_t lon_e7;
+	unsigned line_num;
+};
+
+/**
+ * @brief Print the usage
+ */
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s at <zones.csv>\n"
+			"         prints the AT commands to provision the zones\n"
+			"       %s check <zones.csv>\n"
+			"         checks the grid index and a scan of all zones against\n"
+			"         the point lines of the file\n"
+			"       %s bench [<zones.csv>] [--zones <n>]\n"
+			"         checks the grid index against a scan of all zones and\n"
+			"         measures the lookup cost, random zones if no file is given\n"
+			"zones.csv lines: circle,<mode>,<lat>,<lon>,<radius m>\n"
+			"                 poly,<mode>,<lat1>,<lon1>,<lat2>,<lon2>,...\n"
+			"                 point,<zone>,<lat>,<lon>\n"
+			"                 mode 0 = suppress, 1 = reduce precision\n"
+			"                 zone in file order from 0, -1 for no zone\n",
+			name, name, name);
+}
+
+/**
+ * @brief Read a zone list
+ *
+ * @param file_name CSV file
+ * @param zones zone index to fill
+ * @param at print the AT commands for each zone
+ * @param points if not NULL, filled with the point lines
+ * @return true file read
+ */
+static bool read_zones(const char *file_name, zone_index &zones, bool at, std::vector<zone_point_s> *points = NULL)
+{
+	FILE *in = fopen(file_name, "r");
+	if (in == NULL)
+	{
+		perror(file_name);
+		return false;
+	}
+
+	zones.clear();
+	char line[8192];
+	unsigned line_num = 0;
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		line_num++;
+		char *type = strtok(line, ",\r\n");
+		char *mode = strtok(NULL, ",\r\n");
+		if ((type == NULL) || (type[0] == '#') || (mode == NULL))
+		{
+			continue;
+		}
+		std::vector<double> values;
+		for (char *value = strtok(NULL, ",\r\n"); value != NULL; value = strtok(NULL, ",\r\n"))
+		{
+			values.push_back(atof(value));
+		}
+
+		if ((strcmp(type, "point") == 0) && (values.size() == 2))
+		{
+			if (points != NULL)
+			{
+				zone_point_s point = {atoi(mode), (int32_t)lround(values[0] * 1e7), (int32_t)lround(values[1] * 1e7), line_num};
+				points->push_back(point);
+			}
+		}
+		else if ((strcmp(type, "circle") == 0) && (values.size() == 3))
+		{
+			if (zones.add_circle((uint8_t)atoi(mode), (int32_t)(values[0] * 1e7), (int32_t)(values[1] * 1e7), (uint32_t)values[2]) < 0)
+			{
+				fprintf(stderr, "line %u: no space left\n", line_num);
+				break;
+			}
+			if (at)
+			{
+				printf("AT+ZONEC=%s:%.7f:%.7f:%u\n", mode, values[0], values[1], (unsigned)values[2]);
+			}
+		}
+		else if ((strcmp(type, "poly") == 0) && (values.size() >= 6) && ((values.size() & 1) == 0))
+		{
+			std::vector<zone_vertex_s> points(values.size() / 2);
+			for (size_t idx = 0; idx < points.size(); idx++)
+			{
+				points[idx].lat_e7 = (int32_t)(values[idx * 2] * 1e7);
+				points[idx].lon_e7 = (int32_t)(values[idx * 2 + 1] * 1e7);
+			}
+			if (zones.add_polygon((uint8_t)atoi(mode), &points[0], (uint16_t)points.size()) < 0)
+			{
+				fprintf(stderr, "line %u: no space left\n", line_num);
+				break;
+			}
+			if (at)
+			{
+				for (size_t first = 0; first < points.size(); first += AT_VERTICES)
+				{
+					printf(first == 0 ? "AT+ZONEP=%s" : "AT+ZONEV=", mode);
+					for (size_t idx = first; (idx < points.size()) && (idx < first + AT_VERTICES); idx++)
+					{
+						printf("%s%.7f:%.7f", (first == 0) || (idx > first) ? ":" : "", values[idx * 2], values[idx * 2 + 1]);
+					}
+					printf("\n");
+				}
+			}
+		}
+		else
+		{
+			fprintf(stderr, "line %u: invalid zone\n", line_num);
+		}
+	}
+	fclose(in);
+	if (at)
+	{
+		printf("AT+ZONESAVE\n");
+	}
+	return true;
+}
+
+/**
+ * @brief Random circles and polygons around depots spread over a region
+ *
+ * @param zones zone index to fill
+ * @param count number of zones
+ */
+static void random_zones(zone_index &zones, size_t count)
+{
+	std::mt19937 rng(1);
+	// Region of about 400 x 400 km
+	std::uniform_int_distribution<int32_t> lat(480000000, 515000000);
+	std::uniform_int_distribution<int32_t> lon(60000000, 115000000);
+	std::uniform_int_distribution<uint32_t> radius(50, 2000);
+	std::uniform_int_distribution<int32_t> offset(-20000, 20000);
+	std::uniform_int_distribution<int> vertices(3, 12);
+
+	zones.clear();
+	for (size_t id = 0; id < count; id++)
+	{
+		int32_t center_lat = lat(rng);
+		int32_t center_lon = lon(rng);
+		if ((id & 1) == 0)
+		{
+			zones.add_circle(ZONE_SUPPRESS, center_lat, center_lon, radius(rng));
+			continue;
+		}
+		zone_vertex_s points[12];
+		int num = vertices(rng);
+		for (int idx = 0; idx < num; idx++)
+		{
+			points[idx].lat_e7 = center_lat + offset(rng);
+			points[idx].lon_e7 = center_lon + offset(rng);
+		}
+		zones.add_polygon(ZONE_REDUCE, points, (uint16_t)num);
+	}
+}
+
+/**
+ * @brief Check the index and a scan of all zones against positions with known result
+ *
+ * @param zones zones to test
+ * @param points positions and the zone they are in
+ * @return int 0 if all positions are found in the expected zone
+ */
+static int check(zone_index &zones, const std::vector<zone_point_s> &points)
+{
+	if (points.empty())
+	{
+		fprintf(stderr, "no points\n");
+		return 1;
+	}
+	if (!zones.build())
+	{
+		printf("index too large, find() scans all zones\n");
+	}
+
+	size_t errors = 0;
+	for (size_t idx = 0; idx < points.size(); idx++)
+	{
+		const zone_point_s &point = points[idx];
+		int scan = -1;
+		for (uint16_t id = 0; id < zones.zone_count; id++)
+		{
+			if (zones.contains(zones.zones[id], point.lat_e7, point.lon_e7))
+			{
+				scan = id;
+				break;
+			}
+		}
+		int found = zones.find(point.lat_e7, point.lon_e7);
+		if ((scan != point.zone) || (found != point.zone))
+		{
+			printf("line %u: %.7f %.7f expected zone %d, scan %d, index %d\n",
+				   point.line_num, point.lat_e7 / 1e7, point.lon_e7 / 1e7, point.zone, scan, found);
+			errors++;
+		}
+	}
+	printf("%u zones, %u vertices, %zu points, %zu mismatches\n",
+		   zones.zone_count, zones.vertex_count, points.size(), errors);
+	return errors == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Check the index against a scan of all zones and measure the lookup cost
+ *
+ * @param zones zones to test
+ * @return int 0 if the index agrees with the scan
+ */
+static int bench(zone_index &zones)
+{
+	if (zones.zone_count == 0)
+	{
+		fprintf(stderr, "no zones\n");
+		return 1;
+	}
+
+	// Probes spread over the bounding box of all zones, half of them near a zone
+	int32_t lat_min = zones.zones[0].lat_min, lat_max = zones.zones[0].lat_max;
+	int32_t lon_min = zones.zones[0].lon_min, lon_max = zones.zones[0].lon_max;
+	for (uint16_t id = 0; id < zones.zone_count; id++)
+	{
+		// lon_min is larger than lon_max for zones across the 180th meridian, both are checked
+		const zone_s &zone = zones.zones[id];
+		lat_min = zone.lat_min < lat_min ? zone.lat_min : lat_min;
+		lat_max = zone.lat_max > lat_max ? zone.lat_max : lat_max;
+		lon_min = zone.lon_min < lon_min ? zone.lon_min : lon_min;
+		lon_min = zone.lon_max < lon_min ? zone.lon_max : lon_min;
+		lon_max = zone.lon_max > lon_max ? zone.lon_max : lon_max;
+		lon_max = zone.lon_min > lon_max ? zone.lon_min : lon_max;
+	}
+	std::mt19937 rng(2);
+	std::uniform_int_distribution<int32_t> lat(lat_min, lat_max);
+	std::uniform_int_distribution<int32_t> lon(lon_min, lon_max);
+	std::uniform_int_distribution<uint16_t> zone_id(0, zones.zone_count - 1);
+	std::uniform_int_distribution<int32_t> offset(-30000, 30000);
+	std::vector<zone_vertex_s> probes(1000000);
+	for (size_t idx = 0; idx < probes.size(); idx++)
+	{
+		if (idx & 1)
+		{
+			const zone_vertex_s &near = zones.vertices[zones.zones[zone_id(rng)].first_vertex];
+			probes[idx].lat_e7 = near.lat_e7 + offset(rng);
+			probes[idx].lon_e7 = near.lon_e7 + offset(rng);
+		}
+		else
+		{
+			probes[idx].lat_e7 = lat(rng);
+			probes[idx].lon_e7 = lon(rng);
+		}
+	}
+
+	// Scan of all zones without index
+	std::vector<int> expected(probes.size());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < probes.size(); idx++)
+	{
+		expected[idx] = -1;
+		for (uint16_t id = 0; id < zones.zone_count; id++)
+		{
+			if (zones.contains(zones.zones[id], probes[idx].lat_e7, probes[idx].lon_e7))
+			{
+				expected[idx] = id;
+				break;
+			}
+		}
+	}
+	double scan_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!zones.build())
+	{
+		printf("index too large, find() scans all zones\n");
+	}
+	size_t hits = 0, errors = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t idx = 0; idx < probes.size(); idx++)
+	{
+		int found = zones.find(probes[idx].lat_e7, probes[idx].lon_e7);
+		hits += found >= 0 ? 1 : 0;
+		// A position in overlapping zones can report any of them
+		if ((found < 0) != (expected[idx] < 0))
+		{
+			errors++;
+		}
+		else if ((found >= 0) && !zones.contains(zones.zones[found], probes[idx].lat_e7, probes[idx].lon_e7))
+		{
+			errors++;
+		}
+	}
+	double index_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%u zones, %u vertices, %zu probes, %zu in a zone\n",
+		   zones.zone_count, zones.vertex_count, probes.size(), hits);
+	printf("scan   %8.1f ns/lookup\n", scan_seconds * 1e9 / probes.size());
+	printf("index  %8.1f ns/lookup\n", index_seconds * 1e9 / probes.size());
+	printf("%zu mismatches\n", errors);
+	return errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	static zone_index zones;
+
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((strcmp(argv[1], "at") == 0) && (argc >= 3))
+	{
+		return read_zones(argv[2], zones, true) ? 0 : 1;
+	}
+
+	if ((strcmp(argv[1], "check") == 0) && (argc >= 3))
+	{
+		std::vector<zone_point_s> points;
+		if (!read_zones(argv[2], zones, false, &points))
+		{
+			return 1;
+		}
+		return check(zones, points);
+	}
+
+	if (strcmp(argv[1], "bench") == 0)
+	{
+		if ((argc >= 3) && (strcmp(argv[2], "--zones") != 0))
+		{
+			if (!read_zones(argv[2], zones, false))
+			{
+				return 1;
+			}
+		}
+		else
+		{
+			size_t count = 200;
+			if ((argc >= 4) && (strcmp(argv[2], "--zones") == 0))
+			{
+				count = (size_t)atol(argv[3]);
+			}
+			random_zones(zones, count > ZONE_MAX ? ZONE_MAX : count);
+		}
+		return bench(zones);
+	}
+
+	usage(argv[0]);
+	return 1;
+}